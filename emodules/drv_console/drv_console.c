@@ -23,6 +23,8 @@ uintptr_t uart16550_clock = 3686400; // a "common" base clock
 #define UART_REG_SCR 7	 // scratch register
 #define UART_REG_STATUS_RX 0x01
 #define UART_REG_STATUS_TX 0x20
+#define UART_FIFO_DEPTH 16 // TX FIFO of a 16550A
+#define UART_FCR_ENABLE 0x07 // enable FIFOs, clear RX and TX
 
 // We cannot use the word DEFAULT for a parameter that cannot be overridden due to -Werror
 #ifndef UART_DEFAULT_BAUD
@@ -41,6 +43,26 @@ int uart16550_putchar(uint8_t ch)
 	return 0;
 }
 
+/*
+ * THRE is only set once the whole TX FIFO has drained, so after each poll
+ * a full FIFO worth of bytes can be queued without looking at LSR again.
+ */
+uintptr_t uart16550_write(const uint8_t *buf, uintptr_t len)
+{
+	uintptr_t i, burst;
+
+	for (i = 0; i < len; i += burst) {
+		while ((uart16550[UART_REG_LSR << uart16550_reg_shift] &
+			UART_REG_STATUS_TX) == 0)
+			;
+		burst = len - i < UART_FIFO_DEPTH ? len - i : UART_FIFO_DEPTH;
+		for (uintptr_t j = 0; j < burst; j++)
+			uart16550[UART_REG_QUEUE << uart16550_reg_shift] =
+				buf[i + j];
+	}
+	return len;
+}
+
 int uart16550_getchar(uint8_t *ch)
 {
 	while ((uart16550[UART_REG_LSR << uart16550_reg_shift] &
@@ -71,6 +93,8 @@ int uart16550_init(uintptr_t reg_addr)
 		0x05; // Disable all interrupts
 	uart16550[UART_REG_LCR << uart16550_reg_shift] =
 		0x13; // Enable DLAB (set baud rate divisor)
+	uart16550[UART_REG_FCR << uart16550_reg_shift] =
+		UART_FCR_ENABLE; // TX bursts in `uart16550_write' need the FIFO
 	// uart16550[UART_REG_DLL << uart16550_reg_shift] = (uint8_t)divisor;    // Set divisor (lo byte)
 	// uart16550[UART_REG_DLM << uart16550_reg_shift] = (uint8_t)(divisor >> 8);     //     (hi byte)
 	// uart16550[UART_REG_LCR << uart16550_reg_shift] = 0x03;                // 8 bits, no parity, one stop bit
@@ -78,24 +102,32 @@ int uart16550_init(uintptr_t reg_addr)
 	return 0;
 }
 
-uintptr_t uart16550_cmd_handler(uintptr_t cmd, uintptr_t arg0, uintptr_t arg1,
-				uintptr_t arg2)
-	__attribute__((section(".text.init")));
-uintptr_t uart16550_cmd_handler(uintptr_t cmd, uintptr_t arg0, uintptr_t arg1,
-				uintptr_t arg2)
+uintptr_t uart16550_desc_handler(const drv_desc_t *desc)
 {
-	switch (cmd) {
+	switch (desc->cmd) {
 	case QUERY_INFO:
 		return (uintptr_t)&ctrl;
 	case CONSOLE_CMD_INIT:
-		return uart16550_init(arg0);
+		return uart16550_init(desc->arg[0]);
 	case CONSOLE_CMD_PUT:
-		return uart16550_putchar((uint8_t)(arg0 & 0xff));
+		return uart16550_putchar((uint8_t)(desc->arg[0] & 0xff));
 	case CONSOLE_CMD_GET:
-		return uart16550_getchar((uint8_t *)arg0);
+		return uart16550_getchar((uint8_t *)desc->arg[0]);
 	case CONSOLE_CMD_DESTORY:
 		return uart16550_destroy();
+	case CONSOLE_CMD_WRITE:
+		return uart16550_write((const uint8_t *)desc->arg[0],
+				       desc->arg[1]);
 	default:
 		return -1;
 	}
+}
+
+uintptr_t uart16550_cmd_handler(uintptr_t cmd, uintptr_t arg0, uintptr_t arg1,
+				uintptr_t arg2)
+	__attribute__((section(".text.init")));
+uintptr_t uart16550_cmd_handler(uintptr_t cmd, uintptr_t arg0, uintptr_t arg1,
+				uintptr_t arg2)
+{
+	return drv_scalar_shim(uart16550_desc_handler, cmd, arg0, arg1, arg2);
 }
\ No newline at end of file
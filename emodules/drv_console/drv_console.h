@@ -11,6 +11,7 @@
 #define CONSOLE_CMD_PUT 1
 #define CONSOLE_CMD_GET 2
 #define CONSOLE_CMD_DESTORY 3
+#define CONSOLE_CMD_WRITE 4 // (buf, len), returns bytes written
 #define CONSOLE_REG_ADDR 0x10000000
 #define CONSOLE_REG_SIZE 0x400
 #define SUNXI_UART_BASE 0x02500000
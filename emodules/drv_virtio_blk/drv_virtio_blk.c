@@ -0,0 +1,388 @@
+#include "drv_virtio_blk.h"
+
+/*
+ * Polled virtio-blk driver. Requests are built directly on top of enclave
+ * buffers: the base module hands in a VA-to-PA callback, and every data
+ * segment points at the caller's pages, so block data never leaves the
+ * enclave's own sections. A batch of requests is queued with a single
+ * notify and then polled to completion.
+ */
+
+drv_ctrl_t ctrl = {
+	.reg_addr = VIRTIO_BLK_REG_ADDR,
+	.reg_size = VIRTIO_BLK_REG_SIZE,
+};
+
+typedef struct {
+	uintptr_t user_data;
+	uintptr_t ret;
+	int head; // first descriptor, -1 if rejected before reaching the device
+} blk_inflight_t;
+
+/* Runtime state, no pointers are initialized statically (we are copied) */
+volatile uint8_t *blk_regs;
+uint32_t blk_version;
+va_to_pa_t blk_va_to_pa;
+uint64_t blk_capacity;
+uint16_t blk_queue_size;
+
+struct vring_desc *blk_desc;
+struct vring_avail *blk_avail;
+struct vring_used *blk_used;
+struct virtio_blk_req_hdr *blk_hdrs;
+volatile uint8_t *blk_status;
+
+uint16_t blk_avail_idx;
+uint16_t blk_next_desc;
+blk_inflight_t blk_inflight[BLK_MAX_INFLIGHT];
+int blk_n_inflight;
+
+static inline uint32_t blk_read32(uintptr_t off)
+{
+	return *(volatile uint32_t *)(blk_regs + off);
+}
+
+static inline void blk_write32(uintptr_t off, uint32_t val)
+{
+	*(volatile uint32_t *)(blk_regs + off) = val;
+}
+
+static uintptr_t blk_pa(void *va)
+{
+	return blk_va_to_pa((uintptr_t)va);
+}
+
+// `reg_va' is the slot the base module found, make sure it is a block device
+static int virtio_blk_probe(uintptr_t reg_va)
+{
+	blk_regs = (volatile uint8_t *)reg_va;
+	if (blk_read32(VIRTIO_MMIO_MAGIC_VALUE) == VIRTIO_MMIO_MAGIC &&
+	    blk_read32(VIRTIO_MMIO_DEVICE_ID) == VIRTIO_ID_BLOCK)
+		return 0;
+	blk_regs = 0;
+	return -1;
+}
+
+uintptr_t virtio_blk_init(uintptr_t reg_va, uintptr_t va_to_pa,
+			  uintptr_t dma_va)
+{
+	uint32_t status, qmax;
+	uintptr_t dma_pa, off;
+
+	if (virtio_blk_probe(reg_va))
+		return 0;
+
+	blk_va_to_pa = (va_to_pa_t)va_to_pa;
+	blk_version  = blk_read32(VIRTIO_MMIO_VERSION);
+
+	// Reset, then acknowledge
+	blk_write32(VIRTIO_MMIO_STATUS, 0);
+	status = VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER;
+	blk_write32(VIRTIO_MMIO_STATUS, status);
+
+	// No optional block features, modern devices need VERSION_1
+	blk_write32(VIRTIO_MMIO_DRIVER_FEATURES_SEL, 0);
+	blk_write32(VIRTIO_MMIO_DRIVER_FEATURES, 0);
+	if (blk_version >= 2) {
+		blk_write32(VIRTIO_MMIO_DRIVER_FEATURES_SEL, 1);
+		blk_write32(VIRTIO_MMIO_DRIVER_FEATURES,
+			    1 << (VIRTIO_F_VERSION_1 - 32));
+		status |= VIRTIO_STATUS_FEATURES_OK;
+		blk_write32(VIRTIO_MMIO_STATUS, status);
+		if (!(blk_read32(VIRTIO_MMIO_STATUS) &
+		      VIRTIO_STATUS_FEATURES_OK))
+			goto fail;
+	} else {
+		blk_write32(VIRTIO_MMIO_GUEST_PAGE_SIZE, VIRTIO_BLK_DMA_SIZE);
+	}
+
+	// Lay the queue and the request headers out in the DMA page
+	blk_write32(VIRTIO_MMIO_QUEUE_SEL, 0);
+	qmax = blk_read32(VIRTIO_MMIO_QUEUE_NUM_MAX);
+	if (!qmax)
+		goto fail;
+	blk_queue_size = qmax < BLK_QUEUE_SIZE ? qmax : BLK_QUEUE_SIZE;
+	blk_write32(VIRTIO_MMIO_QUEUE_NUM, blk_queue_size);
+
+	for (off = 0; off < VIRTIO_BLK_DMA_SIZE; off++)
+		((volatile uint8_t *)dma_va)[off] = 0;
+	blk_desc  = (struct vring_desc *)dma_va;
+	blk_avail = (struct vring_avail *)(dma_va +
+					   VRING_AVAIL_OFFSET(blk_queue_size));
+	blk_used  = (struct vring_used *)(dma_va +
+					  VRING_USED_OFFSET(blk_queue_size));
+	off	   = (VRING_SIZE(blk_queue_size) + 15) & ~15UL;
+	blk_hdrs   = (struct virtio_blk_req_hdr *)(dma_va + off);
+	blk_status = (volatile uint8_t *)(blk_hdrs + BLK_MAX_INFLIGHT);
+
+	dma_pa = blk_pa((void *)dma_va);
+	if (blk_version >= 2) {
+		blk_write32(VIRTIO_MMIO_QUEUE_DESC_LOW, dma_pa);
+		blk_write32(VIRTIO_MMIO_QUEUE_DESC_HIGH, dma_pa >> 32);
+		blk_write32(VIRTIO_MMIO_QUEUE_AVAIL_LOW, blk_pa(blk_avail));
+		blk_write32(VIRTIO_MMIO_QUEUE_AVAIL_HIGH,
+			    blk_pa(blk_avail) >> 32);
+		blk_write32(VIRTIO_MMIO_QUEUE_USED_LOW, blk_pa(blk_used));
+		blk_write32(VIRTIO_MMIO_QUEUE_USED_HIGH,
+			    blk_pa(blk_used) >> 32);
+		blk_write32(VIRTIO_MMIO_QUEUE_READY, 1);
+	} else {
+		blk_write32(VIRTIO_MMIO_QUEUE_ALIGN, VRING_USED_ALIGN);
+		blk_write32(VIRTIO_MMIO_QUEUE_PFN,
+			    dma_pa / VIRTIO_BLK_DMA_SIZE);
+	}
+
+	status |= VIRTIO_STATUS_DRIVER_OK;
+	blk_write32(VIRTIO_MMIO_STATUS, status);
+
+	blk_capacity = blk_read32(VIRTIO_MMIO_CONFIG) |
+		       (uint64_t)blk_read32(VIRTIO_MMIO_CONFIG + 4) << 32;
+	blk_avail_idx  = 0;
+	blk_next_desc  = 0;
+	blk_n_inflight = 0;
+	return blk_capacity;
+
+fail:
+	blk_write32(VIRTIO_MMIO_STATUS, status | VIRTIO_STATUS_FAILED);
+	blk_regs = 0;
+	return 0;
+}
+
+static void blk_set_desc(int i, uintptr_t pa, uint32_t len, uint16_t flags)
+{
+	blk_desc[i].addr  = pa;
+	blk_desc[i].len	  = len;
+	blk_desc[i].flags = flags;
+	blk_desc[i].next  = (flags & VRING_DESC_F_NEXT) ? i + 1 : 0;
+}
+
+/*
+ * Queue one request without notifying the device. Returns 0 when queued,
+ * -1 when the request itself is invalid and -2 when the queue has no room
+ * left in this batch.
+ */
+static int blk_queue(uint32_t type, uintptr_t buf, uint64_t sector,
+		     uintptr_t n_sectors)
+{
+	uintptr_t seg_pa[BLK_MAX_SEGS], seg_len[BLK_MAX_SEGS];
+	uintptr_t len, va = buf, pa, chunk;
+	int n_segs = 0, slot = blk_n_inflight, d, i;
+	uint16_t data_flags;
+
+	if (!blk_regs || !n_sectors || n_sectors > blk_capacity ||
+	    sector > blk_capacity - n_sectors ||
+	    n_sectors > -1UL / BLK_SECTOR_SIZE)
+		return -1;
+	len = n_sectors * BLK_SECTOR_SIZE;
+	if (buf + len < buf)
+		return -1;
+
+	// Split the buffer into physically contiguous runs, page by page
+	while (len) {
+		pa = blk_va_to_pa(va);
+		if (!pa)
+			return -1;
+		chunk = EPAGE_SIZE - (va & (EPAGE_SIZE - 1));
+		if (chunk > len)
+			chunk = len;
+		if (n_segs && seg_pa[n_segs - 1] + seg_len[n_segs - 1] == pa) {
+			seg_len[n_segs - 1] += chunk;
+		} else {
+			if (n_segs == BLK_MAX_SEGS)
+				return -1;
+			seg_pa[n_segs]	= pa;
+			seg_len[n_segs] = chunk;
+			n_segs++;
+		}
+		va += chunk;
+		len -= chunk;
+	}
+
+	if (slot >= BLK_MAX_INFLIGHT ||
+	    blk_next_desc + n_segs + 2 > blk_queue_size)
+		return -2;
+
+	blk_hdrs[slot].type	= type;
+	blk_hdrs[slot].reserved = 0;
+	blk_hdrs[slot].sector	= sector;
+	blk_status[slot]	= 0xff;
+
+	// Header, data segments, status byte
+	d = blk_next_desc;
+	blk_set_desc(d++, blk_pa(&blk_hdrs[slot]),
+		     sizeof(struct virtio_blk_req_hdr), VRING_DESC_F_NEXT);
+	data_flags = VRING_DESC_F_NEXT;
+	if (type == VIRTIO_BLK_T_IN)
+		data_flags |= VRING_DESC_F_WRITE;
+	for (i = 0; i < n_segs; i++)
+		blk_set_desc(d++, seg_pa[i], seg_len[i], data_flags);
+	blk_set_desc(d++, blk_pa((void *)&blk_status[slot]), 1,
+		     VRING_DESC_F_WRITE);
+
+	blk_avail->ring[blk_avail_idx % blk_queue_size] = blk_next_desc;
+	blk_avail_idx++;
+	blk_inflight[slot].head = blk_next_desc;
+	blk_next_desc		= d;
+	return 0;
+}
+
+// Publish the batch with one notify and poll until every request is back
+static void blk_kick_and_wait(void)
+{
+	int i, queued = 0;
+
+	for (i = 0; i < blk_n_inflight; i++)
+		queued |= blk_inflight[i].head >= 0;
+
+	if (queued) {
+		virtio_wmb();
+		blk_avail->idx = blk_avail_idx;
+		virtio_mb();
+		blk_write32(VIRTIO_MMIO_QUEUE_NOTIFY, 0);
+
+		while (*(volatile uint16_t *)&blk_used->idx != blk_avail_idx)
+			;
+		virtio_rmb();
+		blk_write32(VIRTIO_MMIO_INTERRUPT_ACK,
+			    blk_read32(VIRTIO_MMIO_INTERRUPT_STATUS));
+	}
+
+	for (i = 0; i < blk_n_inflight; i++) {
+		if (blk_inflight[i].head >= 0)
+			blk_inflight[i].ret =
+				blk_status[i] == VIRTIO_BLK_S_OK ? 0 : -1;
+	}
+	blk_next_desc = 0;
+}
+
+// Add a request to the current batch, a rejected one completes with -1
+static void blk_batch_add(uint32_t type, uintptr_t buf, uint64_t sector,
+			  uintptr_t n_sectors, uintptr_t user_data)
+{
+	int slot = blk_n_inflight, rc;
+
+	rc = blk_queue(type, buf, sector, n_sectors);
+	blk_inflight[slot].user_data = user_data;
+	if (rc) {
+		blk_inflight[slot].head = -1;
+		blk_inflight[slot].ret	= -1;
+	}
+	blk_n_inflight++;
+}
+
+static uintptr_t virtio_blk_rw(uint32_t type, uintptr_t buf, uint64_t sector,
+			       uintptr_t n_sectors)
+{
+	if (blk_queue(type, buf, sector, n_sectors))
+		return -1;
+	blk_n_inflight = 1;
+	blk_kick_and_wait();
+	blk_n_inflight = 0;
+	return blk_inflight[0].ret;
+}
+
+uintptr_t virtio_blk_desc_handler(const drv_desc_t *desc)
+{
+	switch (desc->cmd) {
+	case QUERY_INFO:
+		return (uintptr_t)&ctrl;
+	case BLK_CMD_INIT:
+		return virtio_blk_init(desc->arg[0], desc->arg[1],
+				       desc->arg[2]);
+	case BLK_CMD_READ:
+		return virtio_blk_rw(VIRTIO_BLK_T_IN, desc->arg[0],
+				     desc->arg[1], desc->arg[2]);
+	case BLK_CMD_WRITE:
+		return virtio_blk_rw(VIRTIO_BLK_T_OUT, desc->arg[0],
+				     desc->arg[1], desc->arg[2]);
+	case BLK_CMD_CAPACITY:
+		return blk_capacity;
+	case BLK_CMD_DESTROY:
+		if (blk_regs)
+			blk_write32(VIRTIO_MMIO_STATUS, 0);
+		blk_regs = 0;
+		return 0;
+	default:
+		return -1;
+	}
+}
+
+static int blk_is_io(const drv_desc_t *desc)
+{
+	return desc->cmd == BLK_CMD_READ || desc->cmd == BLK_CMD_WRITE;
+}
+
+/*
+ * `CMD_SUBMIT': consecutive reads and writes share one notify and one
+ * polling loop, other commands run on their own in submission order.
+ */
+static uintptr_t virtio_blk_submit(drv_ring_t *ring)
+{
+	uintptr_t n = 0;
+	uint32_t cq_free;
+	drv_desc_t *desc;
+	int sq, cq, i;
+
+	while ((sq = ebi_ring_cons_slot(&ring->sq, DRV_RING_ENTRIES)) >= 0) {
+		cq_free = ebi_ring_space(&ring->cq, DRV_RING_ENTRIES);
+		if (!cq_free)
+			break;
+
+		desc = &ring->desc[sq];
+		if (!blk_is_io(desc)) {
+			cq = ebi_ring_prod_slot(&ring->cq, DRV_RING_ENTRIES);
+			if (cq < 0)
+				break;
+			ring->cpl[cq].user_data = desc->user_data;
+			ring->cpl[cq].ret	= virtio_blk_desc_handler(desc);
+			ebi_ring_cons_commit(&ring->sq);
+			ebi_ring_prod_commit(&ring->cq);
+			n++;
+			continue;
+		}
+
+		// Gather a batch, bounded by the CQ room and the virtqueue
+		blk_n_inflight = 0;
+		while (blk_n_inflight < cq_free &&
+		       blk_n_inflight < BLK_MAX_INFLIGHT &&
+		       (sq = ebi_ring_cons_slot(&ring->sq, DRV_RING_ENTRIES)) >= 0) {
+			desc = &ring->desc[sq];
+			if (!blk_is_io(desc))
+				break;
+			if (blk_n_inflight &&
+			    blk_next_desc + BLK_MAX_SEGS + 2 > blk_queue_size)
+				break;
+			blk_batch_add(desc->cmd == BLK_CMD_READ ?
+					      VIRTIO_BLK_T_IN :
+					      VIRTIO_BLK_T_OUT,
+				      desc->arg[0], desc->arg[1], desc->arg[2],
+				      desc->user_data);
+			ebi_ring_cons_commit(&ring->sq);
+		}
+		blk_kick_and_wait();
+
+		// The CQ had room, unless the consumer moved `head' backwards
+		for (i = 0; i < blk_n_inflight; i++) {
+			cq = ebi_ring_prod_slot(&ring->cq, DRV_RING_ENTRIES);
+			if (cq < 0)
+				break;
+			ring->cpl[cq].user_data = blk_inflight[i].user_data;
+			ring->cpl[cq].ret	= blk_inflight[i].ret;
+			ebi_ring_prod_commit(&ring->cq);
+		}
+		n += blk_n_inflight;
+		blk_n_inflight = 0;
+	}
+	return n;
+}
+
+uintptr_t virtio_blk_cmd_handler(uintptr_t cmd, uintptr_t arg0, uintptr_t arg1,
+				 uintptr_t arg2)
+	__attribute__((section(".text.init")));
+uintptr_t virtio_blk_cmd_handler(uintptr_t cmd, uintptr_t arg0, uintptr_t arg1,
+				 uintptr_t arg2)
+{
+	if (cmd == CMD_SUBMIT)
+		return virtio_blk_submit((drv_ring_t *)arg0);
+	return drv_scalar_shim(virtio_blk_desc_handler, cmd, arg0, arg1, arg2);
+}
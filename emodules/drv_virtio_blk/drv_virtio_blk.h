@@ -0,0 +1,42 @@
+#ifndef _DRV_VIRTIO_BLK_H
+#define _DRV_VIRTIO_BLK_H
+
+#include <stdint.h>
+#include <sbi/ebi/drv.h>
+#include <sbi/ebi/memory.h> // EPAGE_SIZE
+#include "../util/drv_ctrl.h"
+#include "../util/virtio_mmio.h"
+
+#define BLK_CMD_INIT 0 // (reg_va, va_to_pa, dma_va), returns capacity in sectors
+#define BLK_CMD_READ 1 // (buf, sector, n_sectors), returns 0 or -1
+#define BLK_CMD_WRITE 2 // (buf, sector, n_sectors), returns 0 or -1
+#define BLK_CMD_CAPACITY 3
+#define BLK_CMD_DESTROY 4
+
+/*
+ * All eight virtio-mmio slots of QEMU `virt'. The base module maps the
+ * window, picks the first slot whose DeviceID is a block device and passes
+ * only that slot to BLK_CMD_INIT.
+ */
+#define VIRTIO_BLK_REG_ADDR 0x10001000
+#define VIRTIO_BLK_REG_SIZE 0x8000
+
+/* One page of enclave memory holds the virtqueue and request headers */
+#define VIRTIO_BLK_DMA_SIZE 0x1000
+
+#define BLK_SECTOR_SIZE 512
+#define BLK_QUEUE_SIZE 32
+#define BLK_MAX_INFLIGHT 8
+#define BLK_MAX_SEGS 8 // physically contiguous runs per request
+
+#define VIRTIO_BLK_T_IN 0
+#define VIRTIO_BLK_T_OUT 1
+#define VIRTIO_BLK_S_OK 0
+
+struct virtio_blk_req_hdr {
+	uint32_t type;
+	uint32_t reserved;
+	uint64_t sector;
+};
+
+#endif
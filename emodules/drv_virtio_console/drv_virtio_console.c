@@ -0,0 +1,292 @@
+#include "drv_virtio_console.h"
+
+/*
+ * Polled virtio-console driver, transmit only. Every descriptor owns one
+ * buffer in the DMA pages, so a write is copied in and queued without
+ * waiting for the device: the caller's buffer can be reused right away.
+ * A whole write, or a whole `CMD_SUBMIT' batch, is published with a
+ * single notify, and completed buffers are only reclaimed when the queue
+ * runs out of free descriptors.
+ */
+
+drv_ctrl_t ctrl = {
+	.reg_addr = VIRTIO_CONSOLE_REG_ADDR,
+	.reg_size = VIRTIO_CONSOLE_REG_SIZE,
+};
+
+/* Runtime state, no pointers are initialized statically (we are copied) */
+volatile uint8_t *vcon_regs;
+uint32_t vcon_version;
+uint16_t vcon_queue_size;
+
+struct vring_desc *vcon_desc;
+struct vring_avail *vcon_avail;
+struct vring_used *vcon_used;
+uint8_t *vcon_bufs;
+
+uint16_t vcon_avail_idx; // next avail index, published on kick
+uint16_t vcon_kicked_idx; // last avail index the device was told about
+uint16_t vcon_used_idx; // next used entry to reclaim
+uint16_t vcon_free[VCON_QUEUE_SIZE];
+int vcon_n_free;
+
+static inline uint32_t vcon_read32(uintptr_t off)
+{
+	return *(volatile uint32_t *)(vcon_regs + off);
+}
+
+static inline void vcon_write32(uintptr_t off, uint32_t val)
+{
+	*(volatile uint32_t *)(vcon_regs + off) = val;
+}
+
+// `reg_va' is the slot the base module found, make sure it is a console
+static int virtio_console_probe(uintptr_t reg_va)
+{
+	vcon_regs = (volatile uint8_t *)reg_va;
+	if (vcon_read32(VIRTIO_MMIO_MAGIC_VALUE) == VIRTIO_MMIO_MAGIC &&
+	    vcon_read32(VIRTIO_MMIO_DEVICE_ID) == VIRTIO_ID_CONSOLE)
+		return 0;
+	vcon_regs = 0;
+	return -1;
+}
+
+uintptr_t virtio_console_init(uintptr_t reg_va, uintptr_t va_to_pa,
+			      uintptr_t dma_va)
+{
+	va_to_pa_t to_pa = (va_to_pa_t)va_to_pa;
+	uint32_t status, qmax;
+	uintptr_t off, ring_pa;
+	int i;
+
+	if (virtio_console_probe(reg_va))
+		return -1;
+
+	vcon_version = vcon_read32(VIRTIO_MMIO_VERSION);
+
+	// Reset, then acknowledge
+	vcon_write32(VIRTIO_MMIO_STATUS, 0);
+	status = VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER;
+	vcon_write32(VIRTIO_MMIO_STATUS, status);
+
+	// No size or multiport features, modern devices need VERSION_1
+	vcon_write32(VIRTIO_MMIO_DRIVER_FEATURES_SEL, 0);
+	vcon_write32(VIRTIO_MMIO_DRIVER_FEATURES, 0);
+	if (vcon_version >= 2) {
+		vcon_write32(VIRTIO_MMIO_DRIVER_FEATURES_SEL, 1);
+		vcon_write32(VIRTIO_MMIO_DRIVER_FEATURES,
+			     1 << (VIRTIO_F_VERSION_1 - 32));
+		status |= VIRTIO_STATUS_FEATURES_OK;
+		vcon_write32(VIRTIO_MMIO_STATUS, status);
+		if (!(vcon_read32(VIRTIO_MMIO_STATUS) &
+		      VIRTIO_STATUS_FEATURES_OK))
+			goto fail;
+	} else {
+		vcon_write32(VIRTIO_MMIO_GUEST_PAGE_SIZE, VCON_PAGE_SIZE);
+	}
+
+	vcon_write32(VIRTIO_MMIO_QUEUE_SEL, VCON_TX_QUEUE);
+	qmax = vcon_read32(VIRTIO_MMIO_QUEUE_NUM_MAX);
+	if (!qmax)
+		goto fail;
+	vcon_queue_size = qmax < VCON_QUEUE_SIZE ? qmax : VCON_QUEUE_SIZE;
+	vcon_write32(VIRTIO_MMIO_QUEUE_NUM, vcon_queue_size);
+
+	for (off = 0; off < VCON_PAGE_SIZE; off++)
+		((volatile uint8_t *)dma_va)[off] = 0;
+	vcon_desc  = (struct vring_desc *)dma_va;
+	vcon_avail = (struct vring_avail *)(dma_va +
+					    VRING_AVAIL_OFFSET(vcon_queue_size));
+	vcon_used  = (struct vring_used *)(dma_va +
+					   VRING_USED_OFFSET(vcon_queue_size));
+	vcon_bufs  = (uint8_t *)(dma_va + VCON_PAGE_SIZE);
+
+	// Descriptor i always points at buffer i, only `len' changes
+	for (i = 0; i < vcon_queue_size; i++) {
+		vcon_desc[i].addr =
+			to_pa((uintptr_t)&vcon_bufs[i * VCON_BUF_SIZE]);
+		vcon_desc[i].len   = 0;
+		vcon_desc[i].flags = 0;
+		vcon_desc[i].next  = 0;
+		vcon_free[i]	   = i;
+	}
+	vcon_n_free = vcon_queue_size;
+
+	ring_pa = to_pa(dma_va);
+	if (vcon_version >= 2) {
+		vcon_write32(VIRTIO_MMIO_QUEUE_DESC_LOW, ring_pa);
+		vcon_write32(VIRTIO_MMIO_QUEUE_DESC_HIGH, ring_pa >> 32);
+		vcon_write32(VIRTIO_MMIO_QUEUE_AVAIL_LOW,
+			     to_pa((uintptr_t)vcon_avail));
+		vcon_write32(VIRTIO_MMIO_QUEUE_AVAIL_HIGH,
+			     to_pa((uintptr_t)vcon_avail) >> 32);
+		vcon_write32(VIRTIO_MMIO_QUEUE_USED_LOW,
+			     to_pa((uintptr_t)vcon_used));
+		vcon_write32(VIRTIO_MMIO_QUEUE_USED_HIGH,
+			     to_pa((uintptr_t)vcon_used) >> 32);
+		vcon_write32(VIRTIO_MMIO_QUEUE_READY, 1);
+	} else {
+		vcon_write32(VIRTIO_MMIO_QUEUE_ALIGN, VRING_USED_ALIGN);
+		vcon_write32(VIRTIO_MMIO_QUEUE_PFN, ring_pa / VCON_PAGE_SIZE);
+	}
+
+	status |= VIRTIO_STATUS_DRIVER_OK;
+	vcon_write32(VIRTIO_MMIO_STATUS, status);
+
+	vcon_avail_idx	= 0;
+	vcon_kicked_idx = 0;
+	vcon_used_idx	= 0;
+	return 0;
+
+fail:
+	vcon_write32(VIRTIO_MMIO_STATUS, status | VIRTIO_STATUS_FAILED);
+	vcon_regs = 0;
+	return -1;
+}
+
+// Give the buffers the device is done with back to the free list
+static void vcon_reclaim(void)
+{
+	uint16_t used_idx = *(volatile uint16_t *)&vcon_used->idx;
+
+	virtio_rmb();
+	while (vcon_used_idx != used_idx) {
+		vcon_free[vcon_n_free++] =
+			vcon_used->ring[vcon_used_idx % vcon_queue_size].id;
+		vcon_used_idx++;
+	}
+}
+
+// Publish everything queued since the last kick with one notify
+static void vcon_kick(void)
+{
+	if (vcon_kicked_idx == vcon_avail_idx)
+		return;
+	virtio_wmb();
+	vcon_avail->idx = vcon_avail_idx;
+	virtio_mb();
+	// The device may still be draining the previous batch
+	if (!(*(volatile uint16_t *)&vcon_used->flags & VRING_USED_F_NO_NOTIFY))
+		vcon_write32(VIRTIO_MMIO_QUEUE_NOTIFY, VCON_TX_QUEUE);
+	vcon_kicked_idx = vcon_avail_idx;
+}
+
+static int vcon_get_desc(void)
+{
+	if (!vcon_n_free)
+		vcon_reclaim();
+	if (!vcon_n_free) {
+		// Queue full: push out what is pending and wait for a slot
+		vcon_kick();
+		while (!vcon_n_free)
+			vcon_reclaim();
+	}
+	return vcon_free[--vcon_n_free];
+}
+
+// Copy `buf' into driver buffers and queue them, without notifying
+static uintptr_t vcon_queue(const uint8_t *buf, uintptr_t len)
+{
+	uintptr_t done, chunk, i;
+	uint8_t *dst;
+	int d;
+
+	if (!vcon_regs)
+		return -1;
+
+	for (done = 0; done < len; done += chunk) {
+		d     = vcon_get_desc();
+		dst   = &vcon_bufs[d * VCON_BUF_SIZE];
+		chunk = len - done < VCON_BUF_SIZE ? len - done : VCON_BUF_SIZE;
+		for (i = 0; i < chunk; i++)
+			dst[i] = buf[done + i];
+		vcon_desc[d].len = chunk;
+		vcon_avail->ring[vcon_avail_idx % vcon_queue_size] = d;
+		vcon_avail_idx++;
+	}
+	return len;
+}
+
+static uintptr_t virtio_console_write(const uint8_t *buf, uintptr_t len)
+{
+	uintptr_t ret = vcon_queue(buf, len);
+
+	vcon_kick();
+	return ret;
+}
+
+static uintptr_t virtio_console_putchar(uint8_t ch)
+{
+	return virtio_console_write(&ch, 1) == 1 ? 0 : -1;
+}
+
+static uintptr_t virtio_console_destroy(void)
+{
+	if (vcon_regs) {
+		// Let the last batch drain before resetting the device
+		vcon_kick();
+		while (vcon_used_idx != vcon_avail_idx)
+			vcon_reclaim();
+		vcon_write32(VIRTIO_MMIO_STATUS, 0);
+	}
+	vcon_regs = 0;
+	return 0;
+}
+
+uintptr_t virtio_console_desc_handler(const drv_desc_t *desc)
+{
+	switch (desc->cmd) {
+	case QUERY_INFO:
+		return (uintptr_t)&ctrl;
+	case CONSOLE_CMD_INIT:
+		return virtio_console_init(desc->arg[0], desc->arg[1],
+					   desc->arg[2]);
+	case CONSOLE_CMD_PUT:
+		return virtio_console_putchar((uint8_t)(desc->arg[0] & 0xff));
+	case CONSOLE_CMD_DESTORY:
+		return virtio_console_destroy();
+	case CONSOLE_CMD_WRITE:
+		return virtio_console_write((const uint8_t *)desc->arg[0],
+					    desc->arg[1]);
+	default:
+		return -1;
+	}
+}
+
+/* `CMD_SUBMIT': queue every write of the batch, then notify once */
+static uintptr_t virtio_console_submit(drv_ring_t *ring)
+{
+	uintptr_t n = 0;
+	drv_desc_t *desc;
+	int sq, cq;
+
+	while ((sq = ebi_ring_cons_slot(&ring->sq, DRV_RING_ENTRIES)) >= 0) {
+		cq = ebi_ring_prod_slot(&ring->cq, DRV_RING_ENTRIES);
+		if (cq < 0)
+			break;
+		desc			= &ring->desc[sq];
+		ring->cpl[cq].user_data = desc->user_data;
+		if (desc->cmd == CONSOLE_CMD_WRITE)
+			ring->cpl[cq].ret = vcon_queue(
+				(const uint8_t *)desc->arg[0], desc->arg[1]);
+		else
+			ring->cpl[cq].ret = virtio_console_desc_handler(desc);
+		ebi_ring_cons_commit(&ring->sq);
+		ebi_ring_prod_commit(&ring->cq);
+		n++;
+	}
+	vcon_kick();
+	return n;
+}
+
+uintptr_t virtio_console_cmd_handler(uintptr_t cmd, uintptr_t arg0,
+				     uintptr_t arg1, uintptr_t arg2)
+	__attribute__((section(".text.init")));
+uintptr_t virtio_console_cmd_handler(uintptr_t cmd, uintptr_t arg0,
+				     uintptr_t arg1, uintptr_t arg2)
+{
+	if (cmd == CMD_SUBMIT)
+		return virtio_console_submit((drv_ring_t *)arg0);
+	return drv_scalar_shim(virtio_console_desc_handler, cmd, arg0, arg1,
+			       arg2);
+}
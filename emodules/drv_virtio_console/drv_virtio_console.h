@@ -0,0 +1,37 @@
+#ifndef _DRV_VIRTIO_CONSOLE_H
+#define _DRV_VIRTIO_CONSOLE_H
+
+#include <stdint.h>
+#include <sbi/ebi/drv.h>
+#include "../util/drv_ctrl.h"
+#include "../util/virtio_mmio.h"
+/* Same commands as the 16550 driver, the base module uses either one */
+#include "../drv_console/drv_console.h"
+
+/*
+ * CONSOLE_CMD_INIT takes (reg_va, va_to_pa, dma_va) here and returns 0 on
+ * success. CONSOLE_CMD_GET is not supported, there is no receive queue.
+ */
+
+/*
+ * All eight virtio-mmio slots of QEMU `virt', shared with the block driver.
+ * The base module maps the window, picks the first slot whose DeviceID is
+ * a console and passes only that slot to CONSOLE_CMD_INIT.
+ */
+#define VIRTIO_CONSOLE_REG_ADDR 0x10001000
+#define VIRTIO_CONSOLE_REG_SIZE 0x8000
+
+/*
+ * Enclave memory handed to the driver: the transmit virtqueue in the first
+ * page, then one fixed buffer per descriptor.
+ */
+#define VIRTIO_CONSOLE_DMA_SIZE 0x3000
+#define VCON_PAGE_SIZE 0x1000
+#define VCON_QUEUE_SIZE 16
+#define VCON_BUF_SIZE 512
+
+/* Port 0 queues when VIRTIO_CONSOLE_F_MULTIPORT is not negotiated */
+#define VCON_RX_QUEUE 0
+#define VCON_TX_QUEUE 1
+
+#endif
@@ -4,6 +4,11 @@
 #endif
 #include "drv_util.h"
 #include "drv_list.h"
+#include "drv_malloc.h"
+#include "drv_time.h"
+#include "drv_shm.h"
+#include "drv_uring.h"
+#include "drv_chan.h"
 
 #define PUSH(usr_sp, val) \
 	(usr_sp) -= 8;    \
@@ -62,7 +67,13 @@ void init_other_driver()
 	//         peri_reg_list[i] = drv_init_list[i]();
 	//     }
 	// }
-	peri_reg_list[0] = init_console_driver();
+	if (drv_addr_list[DRV_CONSOLE].drv_start)
+		peri_reg_list[DRV_CONSOLE] = init_console_driver();
+	if (drv_addr_list[DRV_VIRTIO_BLK].drv_start)
+		peri_reg_list[DRV_VIRTIO_BLK] = init_virtio_blk_driver();
+	if (drv_addr_list[DRV_VIRTIO_CONSOLE].drv_start)
+		peri_reg_list[DRV_VIRTIO_CONSOLE] =
+			init_virtio_console_driver();
 }
 
 #define SBI_ECALL(__num, __a0, __a1, __a2)                                    \
@@ -95,6 +106,13 @@ void prepare_boot(uintptr_t usr_pc, uintptr_t usr_sp)
 	sstatus &= ~SSTATUS_SPP;
 	write_csr(sstatus, sstatus);
 	usr_sp = init_usr_stack(usr_sp);
+	time_init();
+	uring_init();
+	shm_init();
+	chan_init();
+	ulib_init();
+	// malloc_test();
+	// console_bench();
 	/* allow S mode trap/interrupt */
 	uintptr_t sie = SIE_SEIE | SIE_SSIE;
 	write_csr(sie, sie);
@@ -0,0 +1,82 @@
+#include "drv_chan.h"
+#include "drv_thread.h"
+#include "drv_util.h"
+#include "mm/page_table.h"
+#include <sbi/sbi_ecall_interface.h>
+
+/* Monitor channel ID mapped in each slot, -1 if the slot is unused */
+static intptr_t chan_id[CHAN_SLOTS];
+
+void chan_init(void)
+{
+	int slot;
+
+	for (slot = 0; slot < CHAN_SLOTS; slot++)
+		chan_id[slot] = -1;
+}
+
+// Map a channel to `peer' and return its user VA, 0 on failure
+uintptr_t ebi_chan_open(uintptr_t peer)
+{
+	uintptr_t status, id, pa, va;
+	int slot;
+
+	for (slot = 0; slot < CHAN_SLOTS; slot++) {
+		if (chan_id[slot] < 0)
+			break;
+	}
+	if (slot == CHAN_SLOTS) {
+		em_error("Out of channel slots\n");
+		return 0;
+	}
+
+	SBI_CALL5(SBI_EXT_EBI, peer, 0, 0, SBI_EXT_EBI_CHAN_OPEN);
+	asm volatile("mv %0, a0" : "=r"(status));
+	asm volatile("mv %0, a1" : "=r"(id));
+	asm volatile("mv %0, a2" : "=r"(pa));
+	if (status != EBI_OK)
+		return 0;
+
+	va = EUSR_CHAN_START + slot * SECTION_SIZE;
+	map_mega_page(va, pa, SECTION_SIZE >> EMEGA_PAGE_SHIFT,
+		      PTE_U | PTE_R | PTE_W);
+	chan_id[slot] = id;
+	em_debug("channel %ld to enclave %ld @0x%lx\n", id, peer, va);
+	return va;
+}
+
+// Ring the peer of the channel mapped at `va'
+int ebi_chan_notify(uintptr_t va)
+{
+	uintptr_t slot = (va - EUSR_CHAN_START) / SECTION_SIZE, status;
+
+	if (va < EUSR_CHAN_START || slot >= CHAN_SLOTS || chan_id[slot] < 0)
+		return -1;
+	SBI_CALL5(SBI_EXT_EBI, chan_id[slot], 0, 0, SBI_EXT_EBI_CHAN_NOTIFY);
+	asm volatile("mv %0, a0" : "=r"(status));
+	return status == EBI_OK ? 0 : -1;
+}
+
+/*
+ * Doorbells as a mask of slots. A suspended wait comes back with nothing
+ * taken, so ask again until something rang. Other threads may trap in
+ * meanwhile, the base lock is only held again to read the slots.
+ */
+uintptr_t ebi_chan_wait(uintptr_t block)
+{
+	uintptr_t bells, mask = 0;
+	int slot;
+
+	base_unlock();
+	do {
+		SBI_CALL5(SBI_EXT_EBI, block, 0, 0, SBI_EXT_EBI_CHAN_WAIT);
+		asm volatile("mv %0, a1" : "=r"(bells));
+	} while (!bells && block);
+	base_lock();
+
+	for (slot = 0; slot < CHAN_SLOTS; slot++) {
+		if (chan_id[slot] >= 0 && (bells & (1UL << chan_id[slot])))
+			mask |= 1UL << slot;
+	}
+	return mask;
+}
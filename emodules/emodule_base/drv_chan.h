@@ -0,0 +1,27 @@
+#ifndef DRV_CHAN_H
+#define DRV_CHAN_H
+
+#include "drv_mem.h"
+
+/*
+ * Channels to other enclaves, see <sbi/ebi/channel.h>. Both sides call
+ * `SYS_ebi_chan_open' naming the other one's EID and get the same section
+ * mapped for the user, one 8 MiB slot per channel from EUSR_CHAN_START.
+ * What goes in the section is up to the two payloads; the monitor only
+ * carries doorbells. `SYS_ebi_chan_wait' returns the slots whose peers
+ * rang since the last call, one bit per slot, and with `block' set gives
+ * the hart back to the host until one rings.
+ */
+#define EUSR_CHAN_START 0x2800000000UL // 0x28_0000_0000
+#define CHAN_SLOTS 8
+
+#ifndef __ASSEMBLER__
+#include <stdint.h>
+
+void chan_init(void);
+uintptr_t ebi_chan_open(uintptr_t peer);
+int ebi_chan_notify(uintptr_t va);
+uintptr_t ebi_chan_wait(uintptr_t block);
+#endif // __ASSEMBLER__
+
+#endif // DRV_CHAN_H
@@ -4,6 +4,11 @@
 #include "drv_util.h"
 #include "drv_syscall.h"
 #include "drv_base.h"
+#include "drv_chan.h"
+#include "drv_malloc.h"
+#include "drv_ocall.h"
+#include "drv_thread.h"
+#include "drv_uring.h"
 #include <sbi/sbi_ecall_interface.h>
 
 #define SHOW_REG(regs, regname) \
@@ -54,25 +59,17 @@ void handle_exception(uintptr_t *regs, uintptr_t scause, uintptr_t sepc,
 	em_error("scause=%d, sepc=0x%llx, stval=0x%llx!\n", scause, sepc,
 		 stval);
 	dump_umode_regs(regs);
-	SBI_CALL5(SBI_EXT_EBI, enclave_id, 0, 0, SBI_EXT_EBI_EXIT);
+	ebi_exit(0);
 }
 
-void handle_syscall(uintptr_t *regs, uintptr_t scause, uintptr_t sepc,
-		    uintptr_t stval)
+/*
+ * Common syscall dispatcher, shared by the trapping path and the submission
+ * ring. `args' holds a0 - a5.
+ */
+uintptr_t dispatch_syscall(uintptr_t which, const uintptr_t *args)
 {
-	em_debug("Start\n");
-	em_debug("sepc: 0x%lx\n", sepc);
+	uintptr_t arg_0 = args[0], arg_1 = args[1], arg_2 = args[2], retval = 0;
 
-	uintptr_t sstatus = read_csr(sstatus);
-	// sstatus |= SSTATUS_SUM;
-	// write_csr(sstatus, sstatus);
-
-	if (scause != CAUSE_USER_ECALL) {
-		handle_exception(regs, scause, sepc, stval);
-	}
-
-	uintptr_t which = regs[A7_INDEX], arg_0 = regs[A0_INDEX],
-		  arg_1 = regs[A1_INDEX], retval = 0;
 	em_debug("which: %d\n", which);
 	switch (which) {
 	case SYS_fstat:
@@ -80,11 +77,26 @@ void handle_syscall(uintptr_t *regs, uintptr_t scause, uintptr_t sepc,
 		break;
 	case SYS_write:
 		em_debug("SYS_write\n");
-		retval = ebi_write(arg_0, arg_1);
+		retval = ebi_write(arg_0, arg_1, arg_2);
+		break;
+	case SYS_writev:
+		retval = ebi_writev(arg_0, (const struct iovec *)arg_1, arg_2);
 		break;
 	case SYS_close:
 		retval = ebi_close(arg_0);
 		break;
+	case SYS_read:
+		retval = ebi_read(arg_0, arg_1, arg_2);
+		break;
+	case SYS_openat:
+		retval = ebi_openat(arg_0, arg_1, arg_2, args[3]);
+		break;
+	case SYS_open:
+		retval = ebi_openat(AT_FDCWD, arg_0, arg_1, arg_2);
+		break;
+	case SYS_lseek:
+		retval = ebi_lseek(arg_0, arg_1, arg_2);
+		break;
 	case SYS_brk:
 		em_debug("SYS_brk: arg0 = 0x%lx\n", arg_0);
 		retval = ebi_brk(arg_0);
@@ -93,16 +105,62 @@ void handle_syscall(uintptr_t *regs, uintptr_t scause, uintptr_t sepc,
 		retval = ebi_gettimeofday((struct timeval *)arg_0,
 					  (struct timezone *)arg_1);
 		break;
+	case SYS_clock_gettime:
+		retval = ebi_clock_gettime(arg_0, (struct timespec *)arg_1);
+		break;
+	case SYS_ebi_morecore:
+		retval = ebi_morecore(arg_0, arg_1);
+		break;
+	case SYS_ebi_blk:
+		retval = ebi_blk(arg_0, arg_1, arg_2, args[3]);
+		break;
+	case SYS_ebi_chan_open:
+		retval = ebi_chan_open(arg_0);
+		break;
+	case SYS_ebi_chan_notify:
+		retval = ebi_chan_notify(arg_0);
+		break;
+	case SYS_ebi_chan_wait:
+		retval = ebi_chan_wait(arg_0);
+		break;
+	case SYS_ebi_thread_create:
+		retval = ebi_thread_create(arg_0, arg_1, arg_2, args[3],
+					   args[4]);
+		break;
+	case SYS_ebi_uring_enter:
+		URING->n_enter++;
+		retval = uring_drain();
+		break;
 	case SYS_exit:
 		// SBI_CALL(EBI_EXIT, enclave_id, arg_0, 0);
 		em_debug("SYS_exit\n");
-		SBI_CALL5(SBI_EXT_EBI, enclave_id, arg_0, 0, SBI_EXT_EBI_EXIT);
+		ebi_exit(arg_0);
 		break;
 	default:
 		em_error("syscall %d unimplemented!\n", which);
-		SBI_CALL5(SBI_EXT_EBI, enclave_id, 0, 0, SBI_EXT_EBI_EXIT);
+		ebi_exit(0);
 		break;
 	}
+	return retval;
+}
+
+void handle_syscall(uintptr_t *regs, uintptr_t scause, uintptr_t sepc,
+		    uintptr_t stval)
+{
+	em_debug("Start\n");
+	em_debug("sepc: 0x%lx\n", sepc);
+
+	uintptr_t sstatus = read_csr(sstatus);
+	// sstatus |= SSTATUS_SUM;
+	// write_csr(sstatus, sstatus);
+
+	if (scause != CAUSE_USER_ECALL) {
+		handle_exception(regs, scause, sepc, stval);
+	}
+
+	base_lock();
+	uintptr_t retval = dispatch_syscall(regs[A7_INDEX], &regs[A0_INDEX]);
+	base_unlock();
 	em_debug("Before writing sepc: sepc = 0x%lx\n", sepc);
 	write_csr(sepc, sepc + 4);
 	em_debug("After writing sepc: sepc = 0x%lx\n", read_csr(sepc));
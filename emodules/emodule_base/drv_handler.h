@@ -4,6 +4,7 @@
 #include "enclave.h"
 void handle_interrupt(uintptr_t* regs, uintptr_t scause, uintptr_t sepc, uintptr_t stval);
 void handle_syscall(uintptr_t* regs, uintptr_t scause, uintptr_t sepc, uintptr_t stval);
+uintptr_t dispatch_syscall(uintptr_t which, const uintptr_t *args);
 
 void unimplemented_exception(uintptr_t* regs, uintptr_t scause, uintptr_t sepc, uintptr_t stval);
 #endif
\ No newline at end of file
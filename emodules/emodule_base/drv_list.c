@@ -2,6 +2,9 @@
 #include "mm/drv_page_pool.h"
 #include "mm/page_table.h"
 #include "../drv_console/drv_console.h"
+#include "../drv_virtio_blk/drv_virtio_blk.h"
+#include "../drv_virtio_console/drv_virtio_console.h"
+#include "drv_time.h"
 #include <sbi/sbi_ecall_interface.h>
 
 void drv_fetch(uintptr_t drv_to_fetch)
@@ -14,6 +17,43 @@ void drv_release(uintptr_t drv_to_release)
 	SBI_CALL5(SBI_EXT_EBI, drv_to_release, 0, 0, SBI_EXT_EBI_RELEASE);
 }
 
+/* Driver behind CONSOLE_CMD_*, the virtio console wins when both are up */
+uintptr_t console_drv = DRV_CONSOLE;
+
+static uintptr_t dma_top = EDRV_DMA_START;
+
+// Hand out zeroed enclave pages for device-visible rings and buffers
+static uintptr_t dma_alloc(uintptr_t size)
+{
+	uintptr_t va = dma_top;
+
+	alloc_page(NULL, va, PAGE_UP(size) >> EPAGE_SHIFT,
+		   PTE_V | PTE_W | PTE_R, IDX_DRV);
+	dma_top += PAGE_UP(size);
+	return va;
+}
+
+/*
+ * Offset of the first virtio-mmio slot of the window mapped at `va' that
+ * holds a device of type `id', -1 if there is none. The driver is given
+ * that slot only, and only that slot is reported to the monitor, so two
+ * virtio drivers sharing the window never claim the same device.
+ */
+static intptr_t virtio_mmio_find(uintptr_t va, uintptr_t size, uint32_t id)
+{
+	volatile uint32_t *slot;
+	uintptr_t off;
+
+	for (off = 0; off + VIRTIO_MMIO_SLOT_SIZE <= size;
+	     off += VIRTIO_MMIO_SLOT_SIZE) {
+		slot = (volatile uint32_t *)(va + off);
+		if (slot[VIRTIO_MMIO_MAGIC_VALUE / 4] == VIRTIO_MMIO_MAGIC &&
+		    slot[VIRTIO_MMIO_DEVICE_ID / 4] == id)
+			return off;
+	}
+	return -1;
+}
+
 drv_ctrl_t *init_console_driver()
 {
 	uintptr_t drv_console_start, drv_console_end, console_drv_size,
@@ -56,6 +96,108 @@ drv_ctrl_t *init_console_driver()
 	return console_ctrl;
 }
 
+drv_ctrl_t *init_virtio_blk_driver()
+{
+	uintptr_t blk_va, dma_va, capacity;
+	intptr_t slot;
+	cmd_handler blk_handler;
+	drv_ctrl_t *blk_ctrl;
+
+	em_debug("Start\n");
+	blk_handler = (cmd_handler)drv_addr_list[DRV_VIRTIO_BLK].drv_start;
+	blk_ctrl    = (drv_ctrl_t *)blk_handler(QUERY_INFO, 0, 0, 0);
+
+	blk_va = ioremap(NULL, blk_ctrl->reg_addr, blk_ctrl->reg_size);
+	slot   = virtio_mmio_find(blk_va, blk_ctrl->reg_size, VIRTIO_ID_BLOCK);
+	if (slot < 0) {
+		em_error("No virtio-blk device\n");
+		return NULL;
+	}
+	blk_va += slot;
+	SBI_CALL5(SBI_EXT_EBI, blk_ctrl->reg_addr + slot, blk_va,
+		  VIRTIO_MMIO_SLOT_SIZE, SBI_EXT_EBI_PERI_INFORM);
+
+	// Virtqueue and request headers live in the enclave's own memory
+	dma_va = dma_alloc(VIRTIO_BLK_DMA_SIZE);
+
+	capacity = blk_handler(BLK_CMD_INIT, blk_va, (uintptr_t)get_pa, dma_va);
+	if (!capacity) {
+		em_error("No usable virtio-blk device\n");
+		return NULL;
+	}
+	em_debug("virtio-blk: %ld sectors, regs @0x%lx, dma @0x%lx -> 0x%lx\n",
+		 capacity, blk_va, dma_va, get_pa(dma_va));
+	return blk_ctrl;
+}
+
+drv_ctrl_t *init_virtio_console_driver()
+{
+	uintptr_t vcon_va, dma_va;
+	intptr_t slot;
+	cmd_handler vcon_handler;
+	drv_ctrl_t *vcon_ctrl;
+
+	em_debug("Start\n");
+	vcon_handler =
+		(cmd_handler)drv_addr_list[DRV_VIRTIO_CONSOLE].drv_start;
+	vcon_ctrl = (drv_ctrl_t *)vcon_handler(QUERY_INFO, 0, 0, 0);
+
+	vcon_va = ioremap(NULL, vcon_ctrl->reg_addr, vcon_ctrl->reg_size);
+	slot	= virtio_mmio_find(vcon_va, vcon_ctrl->reg_size,
+				   VIRTIO_ID_CONSOLE);
+	if (slot < 0) {
+		em_error("No virtio-console device\n");
+		return NULL;
+	}
+	vcon_va += slot;
+	SBI_CALL5(SBI_EXT_EBI, vcon_ctrl->reg_addr + slot, vcon_va,
+		  VIRTIO_MMIO_SLOT_SIZE, SBI_EXT_EBI_PERI_INFORM);
+
+	dma_va = dma_alloc(VIRTIO_CONSOLE_DMA_SIZE);
+	if (vcon_handler(CONSOLE_CMD_INIT, vcon_va, (uintptr_t)get_pa,
+			 dma_va)) {
+		em_error("No usable virtio-console device\n");
+		return NULL;
+	}
+	em_debug("virtio-console: regs @0x%lx, dma @0x%lx -> 0x%lx\n", vcon_va,
+		 dma_va, get_pa(dma_va));
+	console_drv = DRV_VIRTIO_CONSOLE;
+	return vcon_ctrl;
+}
+
+#define CONSOLE_BENCH_BYTES (64 * 1024)
+#define CONSOLE_BENCH_CHUNK 256
+
+// Push the same output through each console driver and compare bytes/s
+void console_bench()
+{
+	static char line[CONSOLE_BENCH_CHUNK];
+	static const uintptr_t ids[2] = { DRV_CONSOLE, DRV_VIRTIO_CONSOLE };
+	uintptr_t t1, t2, sent, i;
+	cmd_handler handler;
+
+	for (i = 0; i < CONSOLE_BENCH_CHUNK - 1; i++)
+		line[i] = 'a' + i % 26;
+	line[CONSOLE_BENCH_CHUNK - 1] = '\n';
+
+	print_color("---------------------- start");
+	for (i = 0; i < 2; i++) {
+		if (!peri_reg_list[ids[i]])
+			continue;
+		handler = (cmd_handler)drv_addr_list[ids[i]].drv_start;
+		t1	= read_csr(time);
+		for (sent = 0; sent < CONSOLE_BENCH_BYTES;
+		     sent += CONSOLE_BENCH_CHUNK)
+			handler(CONSOLE_CMD_WRITE, (uintptr_t)line,
+				CONSOLE_BENCH_CHUNK, 0);
+		t2 = read_csr(time);
+		em_debug("driver %d: %ld bytes in %ld ticks, %ld bytes/s\n",
+			 ids[i], sent, t2 - t1,
+			 t2 > t1 ? sent * timebase_freq / (t2 - t1) : 0);
+	}
+	print_color("---------------------- end");
+}
+
 // drv_ctrl_t* init_rtc_driver() {
 //     printd("init rtc driver\n");
 
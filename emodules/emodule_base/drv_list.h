@@ -7,6 +7,11 @@
 
 #define DRV_CONSOLE 0
 #define DRV_RTC 1
+#define DRV_VIRTIO_BLK 2
+#define DRV_VIRTIO_CONSOLE 3
+
+/* Pages handed to drivers for device-visible rings and headers */
+#define EDRV_DMA_START 0xD8000000
 
 typedef uintptr_t (*cmd_handler)(uintptr_t cmd, uintptr_t arg0, uintptr_t arg1,
 				 uintptr_t arg2);
@@ -15,8 +20,12 @@ typedef drv_ctrl_t *(*drv_initer)();
 extern drv_ctrl_t *peri_reg_list[MAX_DRV];
 extern drv_initer drv_init_list[MAX_DRV];
 extern drv_addr_t *drv_addr_list;
+extern uintptr_t console_drv;
 
 drv_ctrl_t *init_console_driver();
 drv_ctrl_t *init_rtc_driver();
+drv_ctrl_t *init_virtio_blk_driver();
+drv_ctrl_t *init_virtio_console_driver();
+void console_bench();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,351 @@
+#include "drv_malloc.h"
+#include "drv_shm.h"
+#include "drv_syscall.h"
+#include "drv_time.h"
+#include "drv_uring.h"
+#include "drv_util.h"
+#include "mm/drv_page_pool.h"
+#include "mm/page_table.h"
+
+#define ULIB_STATE ((ulib_malloc_state_t *)(EUSR_ULIB_START + EPAGE_SIZE))
+#define NEXT_OBJ(obj) (*(uintptr_t *)(obj))
+
+/* Next unmapped VA of each allocator region, only known to the base */
+static uintptr_t slab_top  = EUSR_SLAB_START;
+static uintptr_t large_top = EUSR_LARGE_START;
+
+static uintptr_t __ulib ulib_morecore(uintptr_t kind, uintptr_t n_pages)
+{
+	register uintptr_t a0 asm("a0") = kind;
+	register uintptr_t a1 asm("a1") = n_pages;
+	register uintptr_t a7 asm("a7") = SYS_ebi_morecore;
+	asm volatile("ecall" : "+r"(a0) : "r"(a1), "r"(a7) : "memory");
+	ULIB_STATE->n_refill++;
+	return a0;
+}
+
+static int __ulib ulib_size_to_class(size_t size)
+{
+	int cls = 0;
+
+	size = (size - 1) >> MALLOC_MIN_SHIFT;
+	while (size) {
+		cls++;
+		size >>= 1;
+	}
+	return cls;
+}
+
+static int __ulib ulib_slab_refill(int cls)
+{
+	ulib_malloc_state_t *state = ULIB_STATE;
+	uintptr_t obj_size	   = 1UL << (cls + MALLOC_MIN_SHIFT);
+	uintptr_t slab, obj;
+	malloc_hdr_t *hdr;
+
+	slab = ulib_morecore(MORECORE_SLAB, SLAB_SIZE >> EPAGE_SHIFT);
+	if (!slab)
+		return -1;
+
+	hdr	     = (malloc_hdr_t *)slab;
+	hdr->magic   = SLAB_MAGIC;
+	hdr->cls     = cls;
+	hdr->n_pages = SLAB_SIZE >> EPAGE_SHIFT;
+
+	// Thread the objects in address order, right after the header
+	obj = slab + MALLOC_ALIGN;
+	for (; obj + 2 * obj_size <= slab + SLAB_SIZE; obj += obj_size)
+		NEXT_OBJ(obj) = obj + obj_size;
+	NEXT_OBJ(obj)	       = state->free_list[cls];
+	state->free_list[cls] = slab + MALLOC_ALIGN;
+	return 0;
+}
+
+static void *__ulib ulib_large_alloc(size_t size)
+{
+	ulib_malloc_state_t *state = ULIB_STATE;
+	uintptr_t n_pages = PAGE_UP(size + sizeof(malloc_hdr_t)) >> EPAGE_SHIFT;
+	large_run_t *run, *best = NULL;
+	malloc_hdr_t *hdr;
+	uintptr_t va;
+	int i;
+
+	// Best fit among the runs released so far
+	for (i = 0; i < MALLOC_LARGE_MAX; i++) {
+		run = &state->large_free[i];
+		if (!run->va || run->n_pages < n_pages)
+			continue;
+		if (!best || run->n_pages < best->n_pages)
+			best = run;
+	}
+
+	if (best) {
+		va = best->va;
+		if (best->n_pages > n_pages) {
+			best->va += n_pages << EPAGE_SHIFT;
+			best->n_pages -= n_pages;
+		} else {
+			best->va      = 0;
+			best->n_pages = 0;
+		}
+	} else {
+		va = ulib_morecore(MORECORE_LARGE, n_pages);
+		if (!va)
+			return NULL;
+	}
+
+	hdr	     = (malloc_hdr_t *)va;
+	hdr->magic   = LARGE_MAGIC;
+	hdr->cls     = MALLOC_NUM_CLASS;
+	hdr->n_pages = n_pages;
+	return (void *)(va + MALLOC_ALIGN);
+}
+
+static void __ulib ulib_large_free(malloc_hdr_t *hdr)
+{
+	ulib_malloc_state_t *state = ULIB_STATE;
+	uintptr_t va = (uintptr_t)hdr, n_pages = hdr->n_pages;
+	large_run_t *run, *slot = NULL;
+	int i;
+
+	hdr->magic = 0;
+
+	// Merge with adjacent free runs
+	for (i = 0; i < MALLOC_LARGE_MAX; i++) {
+		run = &state->large_free[i];
+		if (!run->va)
+			continue;
+		if (run->va + (run->n_pages << EPAGE_SHIFT) == va) {
+			va = run->va;
+			n_pages += run->n_pages;
+			run->va = 0;
+		} else if (va + (n_pages << EPAGE_SHIFT) == run->va) {
+			n_pages += run->n_pages;
+			run->va = 0;
+		}
+	}
+
+	for (i = 0; i < MALLOC_LARGE_MAX; i++) {
+		if (!state->large_free[i].va) {
+			slot = &state->large_free[i];
+			break;
+		}
+	}
+	// Out of slots: the run leaks, but stays mapped
+	if (!slot)
+		return;
+	slot->va      = va;
+	slot->n_pages = n_pages;
+}
+
+/* Threads share the allocator, its state is guarded by `state->lock' */
+static void __ulib ulib_lock(ulib_malloc_state_t *state)
+{
+	while (__atomic_exchange_n(&state->lock, 1, __ATOMIC_ACQUIRE))
+		while (__atomic_load_n(&state->lock, __ATOMIC_RELAXED))
+			;
+}
+
+static void __ulib ulib_unlock(ulib_malloc_state_t *state)
+{
+	__atomic_store_n(&state->lock, 0, __ATOMIC_RELEASE);
+}
+
+static void *__ulib ulib_malloc_locked(size_t size)
+{
+	ulib_malloc_state_t *state = ULIB_STATE;
+	uintptr_t obj;
+	int cls;
+
+	if (size == 0)
+		size = 1;
+	if (size > MALLOC_MAX_SMALL)
+		return ulib_large_alloc(size);
+
+	cls = ulib_size_to_class(size);
+	if (!state->free_list[cls] && ulib_slab_refill(cls))
+		return NULL;
+
+	obj		      = state->free_list[cls];
+	state->free_list[cls] = NEXT_OBJ(obj);
+	return (void *)obj;
+}
+
+static malloc_hdr_t *__ulib ulib_hdr_of(void *ptr)
+{
+	uintptr_t addr = (uintptr_t)ptr;
+
+	if (addr >= EUSR_SLAB_START && addr < EUSR_SLAB_END)
+		return (malloc_hdr_t *)(addr & ~(SLAB_SIZE - 1));
+	if (addr >= EUSR_LARGE_START && addr < EUSR_LARGE_END)
+		return (malloc_hdr_t *)(addr - MALLOC_ALIGN);
+	return NULL;
+}
+
+static void __ulib ulib_free_locked(void *ptr)
+{
+	ulib_malloc_state_t *state = ULIB_STATE;
+	malloc_hdr_t *hdr	   = ulib_hdr_of(ptr);
+
+	if (!ptr || !hdr)
+		return;
+
+	if (hdr->magic == SLAB_MAGIC && hdr->cls < MALLOC_NUM_CLASS) {
+		NEXT_OBJ(ptr)		   = state->free_list[hdr->cls];
+		state->free_list[hdr->cls] = (uintptr_t)ptr;
+	} else if (hdr->magic == LARGE_MAGIC) {
+		ulib_large_free(hdr);
+	}
+}
+
+static void *__ulib ulib_malloc(size_t size)
+{
+	ulib_malloc_state_t *state = ULIB_STATE;
+	void *ptr;
+
+	ulib_lock(state);
+	ptr = ulib_malloc_locked(size);
+	ulib_unlock(state);
+	return ptr;
+}
+
+static void __ulib ulib_free(void *ptr)
+{
+	ulib_malloc_state_t *state = ULIB_STATE;
+
+	ulib_lock(state);
+	ulib_free_locked(ptr);
+	ulib_unlock(state);
+}
+
+static size_t __ulib ulib_usable_size(void *ptr)
+{
+	malloc_hdr_t *hdr = ulib_hdr_of(ptr);
+
+	if (!hdr)
+		return 0;
+	if (hdr->magic == SLAB_MAGIC)
+		return 1UL << (hdr->cls + MALLOC_MIN_SHIFT);
+	if (hdr->magic == LARGE_MAGIC)
+		return (hdr->n_pages << EPAGE_SHIFT) - MALLOC_ALIGN;
+	return 0;
+}
+
+/* `volatile' keeps the compiler from turning these loops into libc calls */
+static void *__ulib ulib_calloc(size_t nmemb, size_t size)
+{
+	size_t total = nmemb * size;
+	volatile uint8_t *p;
+	size_t i;
+
+	if (size && total / size != nmemb)
+		return NULL;
+	p = ulib_malloc(total);
+	if (!p)
+		return NULL;
+	for (i = 0; i < total; i++)
+		p[i] = 0;
+	return (void *)p;
+}
+
+static void *__ulib ulib_realloc(void *ptr, size_t size)
+{
+	size_t old_size = ulib_usable_size(ptr), i;
+	volatile uint8_t *dst;
+	uint8_t *src = ptr;
+
+	if (!ptr)
+		return ulib_malloc(size);
+	if (size <= old_size)
+		return ptr;
+
+	dst = ulib_malloc(size);
+	if (!dst)
+		return NULL;
+	for (i = 0; i < old_size; i++)
+		dst[i] = src[i];
+	ulib_free(ptr);
+	return (void *)dst;
+}
+
+// Map the call table and allocator state for the user
+void ulib_init(void)
+{
+	ulib_table_t *table;
+
+	alloc_page(NULL, EUSR_ULIB_START, EUSR_ULIB_SIZE >> EPAGE_SHIFT,
+		   PTE_U | PTE_R | PTE_W, IDX_USR);
+	my_memset((void *)EUSR_ULIB_START, 0, EUSR_ULIB_SIZE);
+
+	table		     = ULIB_TABLE;
+	table->magic	     = ULIB_MAGIC;
+	table->version	     = ULIB_VERSION;
+	table->malloc	     = ulib_malloc;
+	table->free	     = ulib_free;
+	table->calloc	     = ulib_calloc;
+	table->realloc	     = ulib_realloc;
+	table->timebase_freq = timebase_freq;
+	table->gettimeofday  = ulib_gettimeofday;
+	table->clock_gettime = ulib_clock_gettime;
+	table->uring	     = EUSR_URING_START;
+	table->shm	     = shm_size ? EUSR_SHM_START : 0;
+	table->shm_size	     = shm_size;
+	table->sl_ring	     = shm_sl_ring;
+	table->sl_serve	     = ulib_sl_serve;
+	em_debug("ulib table @0x%lx, malloc @%p\n", table, table->malloc);
+}
+
+// Map a fresh slab or large run for the user-mode allocator, 0 on failure
+uintptr_t ebi_morecore(uintptr_t kind, uintptr_t n_pages)
+{
+	uintptr_t va;
+
+	if (kind == MORECORE_SLAB) {
+		if (slab_top + SLAB_SIZE > EUSR_SLAB_END) {
+			em_error("Slab region exhausted\n");
+			return 0;
+		}
+		va	= slab_top;
+		n_pages = SLAB_SIZE >> EPAGE_SHIFT;
+		slab_top += SLAB_SIZE;
+	} else if (kind == MORECORE_LARGE) {
+		if (!n_pages ||
+		    n_pages > ((EUSR_LARGE_END - large_top) >> EPAGE_SHIFT)) {
+			em_error("Large region exhausted\n");
+			return 0;
+		}
+		va = large_top;
+		large_top += n_pages << EPAGE_SHIFT;
+	} else {
+		return 0;
+	}
+
+	em_debug("kind = %d, va = 0x%lx, n_pages = %d\n", kind, va, n_pages);
+	alloc_page(NULL, va, n_pages, PTE_U | PTE_R | PTE_W, IDX_USR);
+	return va;
+}
+
+// Compare one slab refill against growing `brk' page by page
+void malloc_test()
+{
+	uintptr_t cycle1, cycle2, brk;
+	int i;
+
+	print_color("---------------------- start");
+	cycle1 = read_csr(cycle);
+	ebi_morecore(MORECORE_SLAB, 0);
+	cycle2 = read_csr(cycle);
+	em_debug("morecore: %d pages in %ld cycles\n",
+		 SLAB_SIZE >> EPAGE_SHIFT, cycle2 - cycle1);
+
+	brk    = ebi_brk(0);
+	cycle1 = read_csr(cycle);
+	for (i = 0; i < (SLAB_SIZE >> EPAGE_SHIFT); i++) {
+		brk += EPAGE_SIZE;
+		ebi_brk(brk);
+	}
+	cycle2 = read_csr(cycle);
+	em_debug("brk: %d pages in %ld cycles\n", SLAB_SIZE >> EPAGE_SHIFT,
+		 cycle2 - cycle1);
+	print_color("---------------------- end");
+}
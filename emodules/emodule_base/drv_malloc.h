@@ -0,0 +1,114 @@
+#ifndef DRV_MALLOC_H
+#define DRV_MALLOC_H
+
+#include "drv_mem.h"
+
+/*
+ * The base module exports a small user-mode library through a call table
+ * at a fixed VA. The allocator code runs in U-mode, only refilling slabs and
+ * large runs traps into the base module (`SYS_ebi_morecore'). The time
+ * entries read the `time' CSR and never trap.
+ *
+ * EUSR_ULIB_START ===> -----------------
+ *                        < ulib_table_t > (R/W, user visible)
+ *                      -----------------
+ *                        < ulib_malloc_state_t > (R/W, user visible)
+ *                      -----------------
+ */
+#define EUSR_ULIB_START 0x0ff00000UL // 0x0ff0_0000
+#define EUSR_ULIB_SIZE 0x2000
+
+/* User VA ranges reserved for the allocator, far above the `brk' heap */
+#define EUSR_SLAB_START 0x1000000000UL // 0x10_0000_0000
+#define EUSR_SLAB_SIZE 0x10000000UL // 256 MiB
+#define EUSR_SLAB_END (EUSR_SLAB_START + EUSR_SLAB_SIZE)
+#define EUSR_LARGE_START 0x1800000000UL // 0x18_0000_0000
+#define EUSR_LARGE_SIZE 0x40000000UL // 1 GiB
+#define EUSR_LARGE_END (EUSR_LARGE_START + EUSR_LARGE_SIZE)
+
+/* Size classes are powers of two from 16 bytes to 2 KiB */
+#define MALLOC_MIN_SHIFT 4
+#define MALLOC_MAX_SHIFT 11
+#define MALLOC_NUM_CLASS (MALLOC_MAX_SHIFT - MALLOC_MIN_SHIFT + 1)
+#define MALLOC_MAX_SMALL (1UL << MALLOC_MAX_SHIFT)
+#define MALLOC_ALIGN (1UL << MALLOC_MIN_SHIFT)
+
+/* A slab is mapped in one go, so one trap serves many small objects */
+#define SLAB_SHIFT 16
+#define SLAB_SIZE (1UL << SLAB_SHIFT) // 64 KiB
+#define SLAB_MAGIC 0x534c4142 // "SLAB"
+#define LARGE_MAGIC 0x4c524745 // "LRGE"
+
+/* Freed large runs kept for reuse by the user-mode allocator */
+#define MALLOC_LARGE_MAX 64
+
+#define ULIB_MAGIC 0x62696c75 // "ulib"
+#define ULIB_VERSION 5
+
+/* `kind' argument of `SYS_ebi_morecore' */
+#define MORECORE_SLAB 0
+#define MORECORE_LARGE 1
+
+#ifndef __ASSEMBLER__
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include <time.h>
+
+/*
+ * Everything marked `__ulib' is mapped user-executable and called from
+ * U-mode through `ulib_table_t'. It must stay position independent: no
+ * globals, no string literals, no `switch' (jump tables land in .rodata)
+ * and no calls to functions outside of `.text.ulib'.
+ */
+#define __ulib __attribute__((section(".text.ulib")))
+
+/* Header of a slab or a large run, right at its start */
+typedef struct malloc_hdr {
+	uint32_t magic;
+	uint32_t cls; // size class for slabs
+	uintptr_t n_pages; // page count for large runs
+} malloc_hdr_t;
+
+typedef struct large_run {
+	uintptr_t va;
+	uintptr_t n_pages;
+} large_run_t;
+
+typedef struct ulib_malloc_state {
+	uintptr_t free_list[MALLOC_NUM_CLASS];
+	large_run_t large_free[MALLOC_LARGE_MAX];
+	uintptr_t n_refill; // number of traps taken to get memory
+	uint32_t lock; // taken by `malloc' and `free', threads share the state
+} ulib_malloc_state_t;
+
+typedef struct ulib_table {
+	uint32_t magic;
+	uint32_t version;
+	void *(*malloc)(size_t size);
+	void (*free)(void *ptr);
+	void *(*calloc)(size_t nmemb, size_t size);
+	void *(*realloc)(void *ptr, size_t size);
+	/* Since version 2 */
+	uintptr_t timebase_freq;
+	int (*gettimeofday)(struct timeval *tv, struct timezone *tz);
+	int (*clock_gettime)(uintptr_t clk_id, struct timespec *tp);
+	/* Since version 3 */
+	uintptr_t uring; // `uring_t', SQEs and CQEs follow
+	/* Since version 4 */
+	uintptr_t shm; // host-shared window, 0 if none
+	uintptr_t shm_size;
+	/* Since version 5 */
+	uintptr_t sl_ring; // switchless call slots in the window, 0 if none
+	uintptr_t (*sl_serve)(int64_t (*handler)(uint32_t func,
+						 const uint64_t *args));
+} ulib_table_t;
+
+#define ULIB_TABLE ((ulib_table_t *)EUSR_ULIB_START)
+
+void ulib_init(void);
+uintptr_t ebi_morecore(uintptr_t kind, uintptr_t n_pages);
+void malloc_test();
+#endif // __ASSEMBLER__
+
+#endif // DRV_MALLOC_H
@@ -74,24 +74,29 @@ init_map_alloc_pages(drv_addr_t *drv_list, uintptr_t page_table_start,
 		     size_t usr_avail_size, uintptr_t base_avail_start,
 		     size_t base_avail_size)
 {
-	uintptr_t drv_pa_start, drv_pa_end;
+	uintptr_t drv_pa_start, drv_pa_end, drv_va_start = 0;
 	size_t n_drv_pages;
 	uintptr_t usr_stack_start;
 	size_t n_usr_stack_pages, n_base_stack_pages;
 	uintptr_t drv_sp;
+	int i;
 
-	// Drivers
+	// Drivers, copied back to back right before the list
 	em_debug("drv_list = 0x%lx\n", drv_list);
-	if (drv_list[0].drv_start) {
-		drv_pa_start =
-			PAGE_DOWN(drv_list[0].drv_start - ENC_VA_PA_OFFSET);
+	for (i = 0; i < MAX_DRV; i++) {
+		if (drv_list[i].drv_start &&
+		    (!drv_va_start || drv_list[i].drv_start < drv_va_start))
+			drv_va_start = drv_list[i].drv_start;
+	}
+	if (drv_va_start) {
+		drv_pa_start = PAGE_DOWN(drv_va_start - ENC_VA_PA_OFFSET);
 		drv_pa_end  = PAGE_UP(((uintptr_t)drv_list) +
 				      MAX_DRV * sizeof(drv_addr_t));
 		n_drv_pages = (drv_pa_end - drv_pa_start) >> EPAGE_SHIFT;
 		em_debug("drv_pa_end = 0x%x drv_pa_start = 0x%x\n", drv_pa_end,
 			 drv_pa_start);
 		em_debug("n_drv_pages = %d\n", n_drv_pages);
-		map_page(PAGE_DOWN(drv_list[0].drv_start), drv_pa_start,
+		map_page(PAGE_DOWN(drv_va_start), drv_pa_start,
 			 n_drv_pages, PTE_V | PTE_R | PTE_X | PTE_W);
 		em_debug("\033[1;33mdrv: 0x%x - 0x%x -> 0x%x\n\033[0m",
 			 drv_pa_start, drv_pa_end, __pa(drv_pa_start));
@@ -116,6 +121,8 @@ init_map_alloc_pages(drv_addr_t *drv_list, uintptr_t page_table_start,
 	// Map pages for base module
 	// `.text' section
 	MAP_BASE_SECTION(text, PTE_V | PTE_X | PTE_R);
+	// User-mode library exported through `ulib_table_t'
+	MAP_BASE_SECTION(ulib, PTE_V | PTE_X | PTE_R | PTE_U);
 	// Page table (and trie)
 	map_page(ENC_VA_PA_OFFSET + page_table_start, page_table_start,
 		 (page_table_size) >> EPAGE_SHIFT, PTE_V | PTE_W | PTE_R);
@@ -194,9 +201,11 @@ void init_mem(uintptr_t _, uintptr_t id, uintptr_t payload_pa_start,
 	attest_payload((void *)payload_pa_start, payload_size);
 	enclave_id = id;
 
-	// Transform driver addresses into VA
+	// Transform driver addresses into VA, the list may have holes
 	em_debug("drv_list[0].drv_start = 0x%x\n", drv_list[0].drv_start);
-	for (i = 0; i < MAX_DRV && drv_list[i].drv_start; i++) {
+	for (i = 0; i < MAX_DRV; i++) {
+		if (!drv_list[i].drv_start)
+			continue;
 		drv_list[i].drv_start += ENC_VA_PA_OFFSET;
 		drv_list[i].drv_end += ENC_VA_PA_OFFSET;
 		em_debug("drv_list[%d].drv_start: 0x%x, drv_end: 0x%x\n", i,
@@ -0,0 +1,177 @@
+#include "drv_ocall.h"
+#include "drv_shm.h"
+#include "drv_util.h"
+#include <sbi/sbi_ecall_interface.h>
+
+uintptr_t ocall_area_off = -1UL;
+static ocall_area_t *ocall_area;
+
+#define OCALL_BUF(slot) \
+	((uint8_t *)EUSR_SHM_START + OCALL_BUF_OFF(ocall_area_off, slot))
+
+// Called by `shm_init' once the window is mapped
+void ocall_init(uintptr_t area_off)
+{
+	if (area_off >= shm_size)
+		return;
+	ocall_area_off = area_off;
+	ocall_area     = (ocall_area_t *)(EUSR_SHM_START + area_off);
+	em_debug("OCALL area @0x%lx\n", ocall_area);
+}
+
+int ocall_ready(void)
+{
+	return ocall_area != NULL;
+}
+
+// Window offset of `buf' if all `len' bytes are in the window, else -1
+static uintptr_t shm_offset_of(const void *buf, uintptr_t len)
+{
+	uintptr_t va = (uintptr_t)buf;
+
+	if (va < EUSR_SHM_START || len > shm_size ||
+	    va - EUSR_SHM_START > shm_size - len)
+		return -1UL;
+	return va - EUSR_SHM_START;
+}
+
+/*
+ * Post the call claimed in `slot' and wait for the host. Without a helper
+ * polling the ring we give the hart back to the host until it resumes us;
+ * a host resuming us for another reason just gets suspended again. For a
+ * bounced read, the data is copied to `read_dst' before the slot is freed;
+ * the host claiming more than the `read_len' bytes asked for is an error.
+ */
+static intptr_t ocall_run(int slot, uint32_t func, uint64_t a0, uint64_t a1,
+			  uint64_t a2, uint64_t a3, uint8_t *read_dst,
+			  uintptr_t read_len)
+{
+	sl_slot_t *s = &ocall_area->ring.slot[slot];
+	uint64_t args[SL_ARGS];
+	uint8_t *bounce;
+	intptr_t ret, i;
+
+	args[0] = a0;
+	args[1] = a1;
+	args[2] = a2;
+	args[3] = a3;
+	args[4] = 0;
+	args[5] = 0;
+	sl_call_submit(&ocall_area->ring, slot, func, args);
+
+	while (__atomic_load_n(&s->state, __ATOMIC_ACQUIRE) != SL_DONE) {
+		if (__atomic_load_n(&ocall_area->helper, __ATOMIC_ACQUIRE))
+			continue;
+		ocall_area->n_sync++;
+		console_flush();
+		SBI_CALL5(SBI_EXT_EBI, 0, 0, 0, SBI_EXT_EBI_SUSPEND);
+	}
+
+	ret = s->ret;
+	if (read_dst && ret > 0) {
+		if ((uintptr_t)ret > read_len) {
+			ret = -1;
+		} else {
+			bounce = OCALL_BUF(slot);
+			for (i = 0; i < ret; i++)
+				read_dst[i] = bounce[i];
+		}
+	}
+	__atomic_store_n(&s->state, SL_FREE, __ATOMIC_RELEASE);
+	return ret;
+}
+
+intptr_t ocall_openat(intptr_t dirfd, const char *path, uintptr_t flags,
+		      uintptr_t mode)
+{
+	uintptr_t i;
+	uint8_t *dst;
+	int slot;
+
+	if (!ocall_area || (slot = sl_call_claim(&ocall_area->ring)) < 0)
+		return -1;
+
+	// The path always goes through the bounce buffer, NUL included
+	dst = OCALL_BUF(slot);
+	for (i = 0; i < OCALL_PATH_MAX - 1 && path[i]; i++)
+		dst[i] = path[i];
+	dst[i] = '\0';
+	return ocall_run(slot, OCALL_OPENAT, dirfd,
+			 OCALL_BUF_OFF(ocall_area_off, slot), flags, mode, NULL,
+			 0);
+}
+
+intptr_t ocall_close(uintptr_t fd)
+{
+	int slot;
+
+	if (!ocall_area || (slot = sl_call_claim(&ocall_area->ring)) < 0)
+		return -1;
+	return ocall_run(slot, OCALL_CLOSE, fd, 0, 0, 0, NULL, 0);
+}
+
+intptr_t ocall_lseek(uintptr_t fd, intptr_t offset, uintptr_t whence)
+{
+	int slot;
+
+	if (!ocall_area || (slot = sl_call_claim(&ocall_area->ring)) < 0)
+		return -1;
+	return ocall_run(slot, OCALL_LSEEK, fd, offset, whence, 0, NULL, 0);
+}
+
+/*
+ * Buffers already in the window are handed over as they are. Others go
+ * through the bounce buffer one chunk at a time, stopping at the first
+ * short transfer or error. The host is not trusted with the counts: a
+ * transfer longer than what was asked for is an error.
+ */
+static intptr_t ocall_rw(uint32_t func, uintptr_t fd, uint8_t *buf,
+			 uintptr_t len)
+{
+	uintptr_t off = shm_offset_of(buf, len), done = 0, chunk, i;
+	intptr_t ret;
+	uint8_t *bounce;
+	int slot;
+
+	if (!ocall_area)
+		return -1;
+
+	if (off != -1UL) {
+		if ((slot = sl_call_claim(&ocall_area->ring)) < 0)
+			return -1;
+		ret = ocall_run(slot, func, fd, off, len, 0, NULL, 0);
+		return ret > 0 && (uintptr_t)ret > len ? -1 : ret;
+	}
+
+	while (done < len) {
+		if ((slot = sl_call_claim(&ocall_area->ring)) < 0)
+			return done ? done : -1;
+		bounce = OCALL_BUF(slot);
+		chunk  = MIN(len - done, OCALL_BUF_SIZE);
+		if (func == OCALL_WRITE)
+			for (i = 0; i < chunk; i++)
+				bounce[i] = buf[done + i];
+
+		ret = ocall_run(slot, func, fd,
+				OCALL_BUF_OFF(ocall_area_off, slot), chunk, 0,
+				func == OCALL_READ ? buf + done : NULL, chunk);
+		if (ret > 0 && (uintptr_t)ret > chunk)
+			ret = -1;
+		if (ret < 0)
+			return done ? done : ret;
+		done += ret;
+		if (ret < chunk)
+			break;
+	}
+	return done;
+}
+
+intptr_t ocall_read(uintptr_t fd, void *buf, uintptr_t len)
+{
+	return ocall_rw(OCALL_READ, fd, buf, len);
+}
+
+intptr_t ocall_write(uintptr_t fd, const void *buf, uintptr_t len)
+{
+	return ocall_rw(OCALL_WRITE, fd, (uint8_t *)buf, len);
+}
@@ -0,0 +1,24 @@
+#ifndef DRV_OCALL_H
+#define DRV_OCALL_H
+
+#include <stdint.h>
+#include <sbi/ebi/ocall.h>
+
+#define AT_FDCWD -100
+#define OCALL_PATH_MAX 4096
+
+/* Host file descriptors, everything below is the enclave's own console */
+#define OCALL_FD_MIN 3
+
+extern uintptr_t ocall_area_off;
+
+void ocall_init(uintptr_t area_off);
+int ocall_ready(void);
+intptr_t ocall_openat(intptr_t dirfd, const char *path, uintptr_t flags,
+		      uintptr_t mode);
+intptr_t ocall_close(uintptr_t fd);
+intptr_t ocall_read(uintptr_t fd, void *buf, uintptr_t len);
+intptr_t ocall_write(uintptr_t fd, const void *buf, uintptr_t len);
+intptr_t ocall_lseek(uintptr_t fd, intptr_t offset, uintptr_t whence);
+
+#endif // DRV_OCALL_H
@@ -0,0 +1,61 @@
+#include "drv_shm.h"
+#include "drv_malloc.h"
+#include "drv_ocall.h"
+#include "drv_util.h"
+#include "mm/page_table.h"
+#include <sbi/sbi_ecall_interface.h>
+
+uintptr_t shm_size;
+uintptr_t shm_sl_ring; // user VA of the switchless slots, 0 if none
+
+// Ask the monitor for each shared section and map it for the user
+void shm_init(void)
+{
+	uintptr_t i, pa, sl_off = -1UL, oc_off = -1UL;
+
+	for (i = 0; i < SHM_MAX_SECTIONS; i++) {
+		SBI_CALL5(SBI_EXT_EBI, i, 0, 0, SBI_EXT_EBI_SHARE_INFO);
+		asm volatile("mv %0, a1" : "=r"(pa)); // return value
+		asm volatile("mv %0, a3" : "=r"(sl_off));
+		asm volatile("mv %0, a4" : "=r"(oc_off));
+		if (!pa)
+			break;
+		map_mega_page(EUSR_SHM_START + i * SECTION_SIZE, pa,
+			      SECTION_SIZE >> EMEGA_PAGE_SHIFT,
+			      PTE_U | PTE_R | PTE_W);
+	}
+	shm_size = i * SECTION_SIZE;
+	if (shm_size)
+		em_debug("shared window @0x%lx, 0x%lx bytes\n", EUSR_SHM_START,
+			 shm_size);
+	if (sl_off < shm_size) {
+		shm_sl_ring = EUSR_SHM_START + sl_off;
+		em_debug("switchless slots @0x%lx\n", shm_sl_ring);
+	}
+	ocall_init(oc_off);
+}
+
+/* Worker loop, returns the number of calls this hart served */
+uintptr_t __ulib ulib_sl_serve(sl_handler_t handler)
+{
+	sl_ring_t *ring = (sl_ring_t *)ULIB_TABLE->sl_ring;
+	uintptr_t served = 0, i = 0;
+	sl_slot_t *slot;
+
+	if (!ring || !handler ||
+	    __atomic_load_n(&ring->magic, __ATOMIC_ACQUIRE) != SL_MAGIC)
+		return 0;
+
+	__atomic_fetch_add(&ring->n_workers, 1, __ATOMIC_ACQ_REL);
+	while (!__atomic_load_n(&ring->stop, __ATOMIC_ACQUIRE)) {
+		slot = &ring->slot[i];
+		if (sl_slot_claim(slot)) {
+			sl_slot_done(slot, handler(slot->func, slot->args));
+			served++;
+		}
+		i = (i + 1) & (SL_SLOTS - 1);
+	}
+	__atomic_fetch_add(&ring->n_calls, served, __ATOMIC_RELAXED);
+	__atomic_fetch_sub(&ring->n_workers, 1, __ATOMIC_RELEASE);
+	return served;
+}
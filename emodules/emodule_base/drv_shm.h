@@ -0,0 +1,33 @@
+#ifndef DRV_SHM_H
+#define DRV_SHM_H
+
+#include "drv_mem.h"
+
+/*
+ * Window of host sections lent to this enclave with `SBI_EXT_EBI_SHARE'
+ * before it was entered. The sections are mapped back to back with 2 MiB
+ * pages, in the order the host listed them, and are visible to user code
+ * through `ulib_table_t'. Their contents are whatever the host left there.
+ *
+ * When the host also set up switchless call slots in the window, user code
+ * turns a hart into a worker with `ulib_table_t.sl_serve': it polls the
+ * slots in U-mode and runs each posted call through the given handler until
+ * the monitor raises `stop'.
+ */
+#define EUSR_SHM_START 0x2000000000UL // 0x20_0000_0000
+#define EUSR_SHM_SIZE (SHM_MAX_SECTIONS * SECTION_SIZE)
+
+#ifndef __ASSEMBLER__
+#include <stdint.h>
+#include <sbi/ebi/switchless.h>
+
+typedef int64_t (*sl_handler_t)(uint32_t func, const uint64_t *args);
+
+extern uintptr_t shm_size;
+extern uintptr_t shm_sl_ring;
+
+void shm_init(void);
+uintptr_t ulib_sl_serve(sl_handler_t handler);
+#endif // __ASSEMBLER__
+
+#endif // DRV_SHM_H
@@ -7,7 +7,10 @@
 #include "mm/page_table.h"
 #include "drv_base.h"
 #include "drv_list.h"
+#include "drv_ocall.h"
+#include "drv_time.h"
 #include "../drv_console/drv_console.h"
+#include "../drv_virtio_blk/drv_virtio_blk.h"
 
 extern uintptr_t prog_brk;
 // extern uintptr_t pt_root;
@@ -53,40 +56,148 @@ int ebi_brk(uintptr_t addr)
 	return addr;
 }
 
-int ebi_write(uintptr_t fd, uintptr_t content)
+int ebi_write(uintptr_t fd, uintptr_t content, uintptr_t len)
 {
-	/* stdout */
+	/* stdout and stderr */
 	// drv_fetch(DRV_CONSOLE);
 	cmd_handler console_handler =
-		(cmd_handler)drv_addr_list[DRV_CONSOLE].drv_start;
-	if (fd == 1) {
-		char *str = (char *)content;
-		while (*str) {
-			console_handler(CONSOLE_CMD_PUT, *str, 0, 0);
-			str++;
+		(cmd_handler)drv_addr_list[console_drv].drv_start;
+	if (fd >= OCALL_FD_MIN)
+		return ocall_write(fd, (const void *)content, len);
+	if ((fd != 1 && fd != 2) || !peri_reg_list[console_drv])
+		return -1;
+	// drv_release(DRV_CONSOLE);
+	return console_handler(CONSOLE_CMD_WRITE, content, len, 0);
+}
+
+/* One `CMD_SUBMIT' per batch of iovecs instead of one driver call each */
+static drv_ring_t writev_ring;
+
+int ebi_writev(uintptr_t fd, const struct iovec *iov, uintptr_t iovcnt)
+{
+	cmd_handler console_handler =
+		(cmd_handler)drv_addr_list[console_drv].drv_start;
+	uintptr_t i = 0, total = 0;
+	drv_cpl_t cpl;
+	intptr_t ret;
+
+	// Host files: one OCALL per iovec, stopping at a short write
+	if (fd >= OCALL_FD_MIN) {
+		for (; i < iovcnt; i++) {
+			ret = ocall_write(fd, iov[i].iov_base, iov[i].iov_len);
+			if (ret < 0)
+				return total ? total : ret;
+			total += ret;
+			if ((uintptr_t)ret < iov[i].iov_len)
+				break;
 		}
+		return total;
 	}
-	// drv_release(DRV_CONSOLE);
-	return 0;
+	if ((fd != 1 && fd != 2) || !peri_reg_list[console_drv])
+		return -1;
+
+	drv_ring_init(&writev_ring);
+	while (i < iovcnt) {
+		for (; i < iovcnt; i++) {
+			if (drv_ring_push(&writev_ring, CONSOLE_CMD_WRITE,
+					  (uintptr_t)iov[i].iov_base,
+					  iov[i].iov_len, 0, i))
+				break;
+		}
+		console_handler(CMD_SUBMIT, (uintptr_t)&writev_ring, 0, 0);
+		while (!drv_ring_pop(&writev_ring, &cpl))
+			total += cpl.ret;
+	}
+	return total;
 }
 
 int ebi_close(uintptr_t fd)
 {
+	if (fd >= OCALL_FD_MIN)
+		return ocall_close(fd);
 	return 0;
 }
 
+/* Files live on the host, see drv_ocall.c */
+int ebi_read(uintptr_t fd, uintptr_t buf, uintptr_t len)
+{
+	if (fd < OCALL_FD_MIN)
+		return -1;
+	return ocall_read(fd, (void *)buf, len);
+}
+
+int ebi_openat(uintptr_t dirfd, uintptr_t path, uintptr_t flags,
+	       uintptr_t mode)
+{
+	return ocall_openat(dirfd, (const char *)path, flags, mode);
+}
+
+int ebi_lseek(uintptr_t fd, uintptr_t offset, uintptr_t whence)
+{
+	if (fd < OCALL_FD_MIN)
+		return -1;
+	return ocall_lseek(fd, offset, whence);
+}
+
+/* Enclave-local block I/O, `op' is BLK_CMD_READ or BLK_CMD_WRITE */
+/*
+ * The device DMAs straight into `buf', so every page of it must be one
+ * user mode could touch itself, writable when the disk is read into it.
+ */
+int ebi_blk(uintptr_t op, uintptr_t buf, uintptr_t sector, uintptr_t n_sectors)
+{
+	cmd_handler blk_handler =
+		(cmd_handler)drv_addr_list[DRV_VIRTIO_BLK].drv_start;
+	uintptr_t len, va;
+
+	if (!peri_reg_list[DRV_VIRTIO_BLK])
+		return ERR_DRV_NOT_FND;
+	if (op != BLK_CMD_READ && op != BLK_CMD_WRITE)
+		return -1;
+	if (!n_sectors || n_sectors > -1UL / BLK_SECTOR_SIZE)
+		return -1;
+	len = n_sectors * BLK_SECTOR_SIZE;
+	if (buf + len < buf)
+		return -1;
+	for (va = PAGE_DOWN(buf); va < buf + len; va += EPAGE_SIZE)
+		if (!get_user_pa(va, op == BLK_CMD_READ))
+			return -1;
+	return blk_handler(op, buf, sector, n_sectors);
+}
+
+/*
+ * Trapping fallbacks of the `ulib_table_t' time entries, same clock: the
+ * `time' CSR scaled by the timebase from the monitor.
+ */
 int ebi_gettimeofday(struct timeval *tv, struct timezone *tz)
 {
-	// if (!drv_list[DRV_RTC]) return ERR_DRV_NOT_FND;
-	// if (!tv) return EFAULT;
+	uintptr_t ticks;
 
-	// cmd_handler rtc_handler = (cmd_handler)drv_addr_list[DRV_RTC].drv_start;
+	if (!tv || !timebase_freq)
+		return EFAULT;
+
+	ticks	    = read_csr(time);
+	tv->tv_sec  = TICKS_TO_SEC(ticks, timebase_freq);
+	tv->tv_usec = TICKS_TO_SUBSEC(ticks, timebase_freq, USEC_PER_SEC);
+	if (tz) {
+		tz->tz_minuteswest = 0;
+		tz->tz_dsttime	   = 0;
+	}
 
-	// // uintptr_t time = rtc_handler(RTC_CMD_GET_TIME, 0, 0, 0);
-	// tv->tv_sec = time / 1000000000;
-	// tv->tv_usec = (time % 1000000000) / 1000; //  microsecond (μs)
+	em_debug("gettimeofday: second: %ld, microsecond: %ld\n", tv->tv_sec,
+		 tv->tv_usec);
+	return 0;
+}
+
+int ebi_clock_gettime(uintptr_t clk_id, struct timespec *tp)
+{
+	uintptr_t ticks;
 
-	// em_debug("***** gettimeofday: second: %ld, microsecond: %ld *****\n", tv->tv_sec, tv->tv_usec);
+	if (!tp || !timebase_freq || !CLOCK_ID_VALID(clk_id))
+		return EFAULT;
 
+	ticks	    = read_csr(time);
+	tp->tv_sec  = TICKS_TO_SEC(ticks, timebase_freq);
+	tp->tv_nsec = TICKS_TO_SUBSEC(ticks, timebase_freq, NSEC_PER_SEC);
 	return 0;
 }
\ No newline at end of file
@@ -17,6 +17,7 @@
 #define SYS_fstat 80
 #define SYS_exit 93
 #define SYS_exit_group 94
+#define SYS_clock_gettime 113
 #define SYS_kill 129
 #define SYS_rt_sigaction 134
 #define SYS_times 153
@@ -40,11 +41,21 @@
 #define SYS_lstat 1039
 #define SYS_time 1062
 #define SYS_getmainvars 2011
+/* EBI private syscalls */
+#define SYS_ebi_morecore 3000
+#define SYS_ebi_uring_enter 3001
+#define SYS_ebi_blk 3002
+#define SYS_ebi_chan_open 3003
+#define SYS_ebi_chan_notify 3004
+#define SYS_ebi_chan_wait 3005
+#define SYS_ebi_thread_create 3006
 
 #ifndef __ASSEMBLER__
 #include <sys/stat.h>
 #include <stdint.h>
 #include <sys/time.h>
+#include <sys/uio.h>
+#include <time.h>
 #include "enclave.h"
 
 #define EFAULT -1
@@ -52,7 +63,14 @@
 
 int ebi_fstat(uintptr_t fd, uintptr_t sstat);
 int ebi_brk(uintptr_t addr);
-int ebi_write(uintptr_t fd, uintptr_t content);
+int ebi_write(uintptr_t fd, uintptr_t content, uintptr_t len);
+int ebi_writev(uintptr_t fd, const struct iovec *iov, uintptr_t iovcnt);
 int ebi_close(uintptr_t fd);
+int ebi_read(uintptr_t fd, uintptr_t buf, uintptr_t len);
+int ebi_openat(uintptr_t dirfd, uintptr_t path, uintptr_t flags,
+	       uintptr_t mode);
+int ebi_lseek(uintptr_t fd, uintptr_t offset, uintptr_t whence);
+int ebi_blk(uintptr_t op, uintptr_t buf, uintptr_t sector, uintptr_t n_sectors);
 int ebi_gettimeofday(struct timeval *tv, struct timezone *tz);
+int ebi_clock_gettime(uintptr_t clk_id, struct timespec *tp);
 #endif // __ASSEMBLER__
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include "drv_thread.h"
+#include "drv_base.h"
+#include "drv_util.h"
+#include "mm/drv_page_pool.h"
+#include "mm/page_table.h"
+#include <sbi/sbi_ecall_interface.h>
+
+static uint32_t lock;
+static int lock_owner = -1; // tid holding `lock', -1 if none
+static uint32_t tid_used; // bit `tid' for threads not exited yet
+static uint32_t stack_mapped; // kernel stacks are kept for the next thread
+
+// Thread ID of the caller, from the kernel stack it runs on
+int current_tid(void)
+{
+	uintptr_t sp;
+
+	asm volatile("mv %0, sp" : "=r"(sp));
+	if (sp >= EDRV_STACK_TOP - EDRV_STACK_SIZE)
+		return 0;
+	return (EDRV_THREAD_STACK_TOP - 1 - sp) / EDRV_THREAD_STRIDE + 1;
+}
+
+void base_lock(void)
+{
+	while (__atomic_exchange_n(&lock, 1, __ATOMIC_ACQUIRE))
+		while (__atomic_load_n(&lock, __ATOMIC_RELAXED))
+			;
+	lock_owner = current_tid();
+}
+
+void base_unlock(void)
+{
+	lock_owner = -1;
+	__atomic_store_n(&lock, 0, __ATOMIC_RELEASE);
+}
+
+/*
+ * Start `entry(arg)' in U-mode on another hart, with the user stack `sp'.
+ * Returns the thread ID, -1 if no ID or no hart is free.
+ */
+intptr_t ebi_thread_create(uintptr_t entry, uintptr_t sp, uintptr_t arg,
+			   uintptr_t tp, uintptr_t gp)
+{
+	thread_desc_t desc;
+	uintptr_t status, top;
+	int tid;
+
+	for (tid = 1; tid <= ENC_THREAD_MAX; tid++) {
+		if (!(tid_used & (1U << tid)))
+			break;
+	}
+	if (tid > ENC_THREAD_MAX) {
+		em_error("Out of threads\n");
+		return -1;
+	}
+
+	top = EDRV_THREAD_STACK_TOP - (tid - 1) * EDRV_THREAD_STRIDE;
+	if (!(stack_mapped & (1U << tid))) {
+		alloc_page(NULL, top - EDRV_STACK_SIZE,
+			   EDRV_STACK_SIZE >> EPAGE_SHIFT,
+			   PTE_V | PTE_W | PTE_R, IDX_DRV);
+		stack_mapped |= 1U << tid;
+	}
+
+	desc.tid    = tid;
+	desc.entry  = entry;
+	desc.sp	    = sp;
+	desc.gp	    = gp;
+	desc.tp	    = tp;
+	desc.arg    = arg;
+	desc.kstack = top;
+	SBI_CALL5(SBI_EXT_EBI, &desc, 0, 0, SBI_EXT_EBI_THREAD_CREATE);
+	asm volatile("mv %0, a0" : "=r"(status));
+	if (status != EBI_OK)
+		return -1;
+	tid_used |= 1U << tid;
+	em_debug("thread %d: entry 0x%lx, sp 0x%lx\n", tid, entry, sp);
+	return tid;
+}
+
+/* Exit attempts of the main thread before it gives its hart back */
+#define EXIT_RETRY_MAX 16
+
+/*
+ * End the calling thread. A secondary thread only gives its hart back; the
+ * main one ends the enclave, the monitor stops the other threads first. If
+ * that keeps failing, the main thread suspends so the host can kill it.
+ */
+void ebi_exit(uintptr_t code)
+{
+	int tid = current_tid();
+	int i;
+
+	console_flush();
+	if (lock_owner == tid)
+		base_unlock();
+	if (tid) {
+		__atomic_fetch_and(&tid_used, ~(1U << tid), __ATOMIC_RELEASE);
+		SBI_CALL5(SBI_EXT_EBI, 0, 0, 0, SBI_EXT_EBI_THREAD_EXIT);
+		em_error("thread %d could not exit\n", tid);
+		while (1)
+			;
+	}
+	while (1) {
+		for (i = 0; i < EXIT_RETRY_MAX; i++)
+			SBI_CALL5(SBI_EXT_EBI, enclave_id, code, 0,
+				  SBI_EXT_EBI_EXIT);
+		em_error("enclave %ld could not stop its threads\n",
+			 enclave_id);
+		SBI_CALL5(SBI_EXT_EBI, 0, 0, 0, SBI_EXT_EBI_SUSPEND);
+	}
+}
@@ -0,0 +1,37 @@
+#ifndef DRV_THREAD_H
+#define DRV_THREAD_H
+
+#include "drv_mem.h"
+#include <sbi/ebi/thread.h>
+
+/*
+ * Secondary user threads, each on a hart of its own (see
+ * `SBI_EXT_EBI_THREAD_CREATE'). They share the page table, the user
+ * allocator and every piece of base module state, so the base module runs
+ * one trap at a time behind `base_lock'. Thread `tid' traps on its own
+ * kernel stack below the main one, with an unmapped guard page on top:
+ *
+ * EDRV_STACK_TOP ===> ------------------
+ *                       < main stack >
+ *                     ------------------
+ *                       < guard page >
+ *                     ------------------
+ *                       < thread 1 stack >
+ *                     ------------------
+ *                       < guard page > ...
+ */
+#define EDRV_THREAD_STRIDE (EDRV_STACK_SIZE + EPAGE_SIZE)
+#define EDRV_THREAD_STACK_TOP (EDRV_STACK_TOP - EDRV_THREAD_STRIDE)
+
+#ifndef __ASSEMBLER__
+#include <stdint.h>
+
+int current_tid(void);
+void base_lock(void);
+void base_unlock(void);
+intptr_t ebi_thread_create(uintptr_t entry, uintptr_t sp, uintptr_t arg,
+			   uintptr_t tp, uintptr_t gp);
+void ebi_exit(uintptr_t code);
+#endif // __ASSEMBLER__
+
+#endif // DRV_THREAD_H
@@ -0,0 +1,55 @@
+#include "drv_time.h"
+#include "drv_malloc.h"
+#include "drv_util.h"
+#include <sbi/sbi_ecall_interface.h>
+
+uintptr_t timebase_freq;
+
+// Fetch the timebase from the monitor and let U-mode read `time' directly
+void time_init(void)
+{
+	SBI_CALL5(SBI_EXT_EBI, 0, 0, 0, SBI_EXT_EBI_TIMEBASE);
+	asm volatile("mv %0, a1" : "=r"(timebase_freq)); // return value
+	em_debug("timebase_freq = %ld\n", timebase_freq);
+	if (!timebase_freq)
+		em_error("No timebase-frequency, time syscalls will fail\n");
+
+	set_csr(scounteren, SCOUNTEREN_TM);
+}
+
+/*
+ * The user-mode entries below are reached through `ulib_table_t' and never
+ * trap: they read the `time' CSR and convert it with the timebase copied
+ * into the table by `ulib_init'.
+ */
+int __ulib ulib_gettimeofday(struct timeval *tv, struct timezone *tz)
+{
+	uintptr_t freq = ULIB_TABLE->timebase_freq;
+	uintptr_t ticks;
+
+	if (!freq || !tv)
+		return -1;
+
+	ticks	    = read_csr(time);
+	tv->tv_sec  = TICKS_TO_SEC(ticks, freq);
+	tv->tv_usec = TICKS_TO_SUBSEC(ticks, freq, USEC_PER_SEC);
+	if (tz) {
+		tz->tz_minuteswest = 0;
+		tz->tz_dsttime	   = 0;
+	}
+	return 0;
+}
+
+int __ulib ulib_clock_gettime(uintptr_t clk_id, struct timespec *tp)
+{
+	uintptr_t freq = ULIB_TABLE->timebase_freq;
+	uintptr_t ticks;
+
+	if (!freq || !tp || !CLOCK_ID_VALID(clk_id))
+		return -1;
+
+	ticks	    = read_csr(time);
+	tp->tv_sec  = TICKS_TO_SEC(ticks, freq);
+	tp->tv_nsec = TICKS_TO_SUBSEC(ticks, freq, NSEC_PER_SEC);
+	return 0;
+}
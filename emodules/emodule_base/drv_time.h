@@ -0,0 +1,32 @@
+#ifndef DRV_TIME_H
+#define DRV_TIME_H
+
+#include <stdint.h>
+#include <sys/time.h>
+#include <time.h>
+
+#define SCOUNTEREN_TM (1 << 1)
+
+#define USEC_PER_SEC 1000000UL
+#define NSEC_PER_SEC 1000000000UL
+
+/*
+ * Split a `time' CSR value into whole seconds and the remainder scaled to
+ * `unit' per second. There is no RTC, so the epoch is the platform reset.
+ */
+#define TICKS_TO_SEC(ticks, freq) ((ticks) / (freq))
+#define TICKS_TO_SUBSEC(ticks, freq, unit) (((ticks) % (freq)) * (unit) / (freq))
+
+/* Clocks backed by the `time' CSR, all other ids are rejected */
+#define CLOCK_ID_VALID(id)                                                    \
+	((id) == CLOCK_REALTIME || (id) == CLOCK_MONOTONIC ||                 \
+	 (id) == CLOCK_MONOTONIC_RAW || (id) == CLOCK_BOOTTIME)
+
+/* Ticks per second of the `time' CSR, published by the monitor */
+extern uintptr_t timebase_freq;
+
+void time_init(void);
+int ulib_gettimeofday(struct timeval *tv, struct timezone *tz);
+int ulib_clock_gettime(uintptr_t clk_id, struct timespec *tp);
+
+#endif // DRV_TIME_H
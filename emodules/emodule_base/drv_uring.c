@@ -0,0 +1,61 @@
+#include "drv_uring.h"
+#include "drv_handler.h"
+#include "drv_syscall.h"
+#include "drv_util.h"
+#include "mm/drv_page_pool.h"
+#include "mm/page_table.h"
+
+static int uring_ready;
+
+void uring_init(void)
+{
+	alloc_page(NULL, EUSR_URING_START, EUSR_URING_SIZE >> EPAGE_SHIFT,
+		   PTE_U | PTE_R | PTE_W, IDX_USR);
+	my_memset((void *)EUSR_URING_START, 0, EUSR_URING_SIZE);
+
+	ebi_ring_init(&URING->sq, URING_SQ_ENTRIES);
+	ebi_ring_init(&URING->cq, URING_CQ_ENTRIES);
+	uring_ready = 1;
+	em_debug("uring @0x%lx, %d SQEs, %d CQEs\n", URING, URING_SQ_ENTRIES,
+		 URING_CQ_ENTRIES);
+}
+
+/*
+ * Run every pending SQE through the regular syscall dispatcher. Stops early
+ * when the CQ is full, the remaining SQEs stay queued for the next drain.
+ * Returns the number of SQEs completed.
+ */
+int uring_drain(void)
+{
+	uring_t *ring = URING;
+	uintptr_t opcode, user_data, args[6];
+	int sq, cq, i, n = 0;
+
+	if (!uring_ready)
+		return 0;
+
+	// Sizes of our own, U-mode can write every field of the headers
+	while ((sq = ebi_ring_cons_slot(&ring->sq, URING_SQ_ENTRIES)) >= 0) {
+		cq = ebi_ring_prod_slot(&ring->cq, URING_CQ_ENTRIES);
+		if (cq < 0)
+			break;
+
+		// Snapshot the SQE, user code may reuse the slot right away
+		opcode	  = URING_SQES[sq].opcode;
+		user_data = URING_SQES[sq].user_data;
+		for (i = 0; i < 6; i++)
+			args[i] = URING_SQES[sq].args[i];
+		ebi_ring_cons_commit(&ring->sq);
+
+		URING_CQES[cq].user_data = user_data;
+		if (opcode == SYS_ebi_uring_enter)
+			URING_CQES[cq].res = -1;
+		else
+			URING_CQES[cq].res = dispatch_syscall(opcode, args);
+		ebi_ring_prod_commit(&ring->cq);
+		n++;
+	}
+
+	ring->n_done += n;
+	return n;
+}
@@ -0,0 +1,58 @@
+#ifndef DRV_URING_H
+#define DRV_URING_H
+
+#include <sbi/ebi/ring.h>
+
+/*
+ * Syscall submission ring shared with enclave user code. User code fills
+ * SQEs with a syscall number and arguments, then rings the doorbell
+ * (`SYS_ebi_uring_enter') once for the whole batch, which is the only time
+ * the base module drains the ring. Results come back in order as CQEs
+ * carrying the submitter's `user_data'.
+ *
+ * EUSR_URING_START ===> -----------------
+ *                         < uring_t >      (R/W, user visible)
+ *                       -----------------
+ *                         < SQE array >    (R/W, user visible)
+ *                       -----------------
+ *                         < CQE array >    (R/W, user visible)
+ *                       -----------------
+ */
+#define EUSR_URING_START 0x0ff10000UL // 0x0ff1_0000
+#define EUSR_URING_SIZE 0x3000
+#define EUSR_URING_SQES (EUSR_URING_START + 0x1000)
+#define EUSR_URING_CQES (EUSR_URING_START + 0x2000)
+
+#define URING_SQ_ENTRIES 64
+#define URING_CQ_ENTRIES 128
+
+#ifndef __ASSEMBLER__
+
+typedef struct {
+	uint64_t user_data;
+	uint32_t opcode; // syscall number, as in a7
+	uint32_t flags;
+	uint64_t args[6]; // a0 - a5
+} uring_sqe_t;
+
+typedef struct {
+	uint64_t user_data;
+	int64_t res;
+} uring_cqe_t;
+
+typedef struct {
+	ebi_ring_t sq; // user produces, base consumes
+	ebi_ring_t cq; // base produces, user consumes
+	uint64_t n_enter; // doorbells rung
+	uint64_t n_done; // SQEs completed
+} uring_t;
+
+#define URING ((uring_t *)EUSR_URING_START)
+#define URING_SQES ((uring_sqe_t *)EUSR_URING_SQES)
+#define URING_CQES ((uring_cqe_t *)EUSR_URING_CQES)
+
+void uring_init(void);
+int uring_drain(void);
+
+#endif // __ASSEMBLER__
+#endif // DRV_URING_H
@@ -102,13 +102,28 @@ int snprintf(char *out, size_t n, const char *s, ...)
 	return res;
 }
 
+/*
+ * Console output is collected here and handed to the monitor in one
+ * `SBI_EXT_EBI_PUTS' ecall per line instead of one legacy ecall per byte.
+ * The monitor copies whole words, so keep the buffer 8-byte aligned.
+ */
+static char console_buf[CONSOLE_BUF_SIZE] __attribute__((aligned(8)));
+static unsigned int console_len;
+
+void console_flush(void)
+{
+	if (!console_len)
+		return;
+	SBI_CALL5(SBI_EXT_EBI, console_buf, console_len, 0, SBI_EXT_EBI_PUTS);
+	console_len = 0;
+}
+
 void putstring(const char *s)
 {
 	while (*s) {
-		unsigned int arg0		   = (unsigned int)*s++;
-		register unsigned int a0 asm("a0") = (unsigned int)(arg0);
-		register unsigned int a7 asm("a7") = (unsigned int)(1);
-		asm volatile("ecall" : "+r"(a0) : "r"(a7) : "memory");
+		console_buf[console_len++] = *s;
+		if (*s++ == '\n' || console_len == CONSOLE_BUF_SIZE)
+			console_flush();
 	}
 }
 void vprintd(const char *s, va_list vl)
@@ -44,8 +44,12 @@
 #ifndef __ASSEMBLER__
 
 #include <stdint.h>
+/* Flushed on newline, when full and before the enclave exits */
+#define CONSOLE_BUF_SIZE 1024
+
 void printd(const char *s, ...);
 void putstring(const char *s);
+void console_flush(void);
 void putstring_console(const char *s);
 void *my_memset(void *s, int c, unsigned int n);
 // void show_reg(uintptr_t *regs);
@@ -66,7 +66,8 @@ static uintptr_t trie_get_or_insert(trie_t *t, const uintptr_t va,
 	tmp_pte	     = &page_table[p][l[len - 1]];
 	tmp_pte->ppn = pa >> 12;
 	if (len == 2) {
-		tmp_pte->ppn = (tmp_pte->ppn | MASK_OFFSET) ^ MASK_OFFSET;
+		// A megapage leaves PPN[0] clear, PPN[1] and up are the PA
+		tmp_pte->ppn &= ~((1UL << EPT_LEVEL_BITS) - 1);
 	}
 	tmp_pte->pte_v = tmp_pte->pte_g = 1;
 	// tmp_pte->pte_v = 1;
@@ -167,39 +168,64 @@ void print_pte(uintptr_t va)
 	em_debug("##########PRINT PTE END#################\n");
 }
 
-uintptr_t get_pa(uintptr_t va)
+// Leaf entry mapping `va' and its level (2 for 4K pages), -1 if unmapped
+static int walk_leaf(uintptr_t va, pte_t *leaf)
 {
 	uintptr_t l[] = { (va & MASK_L2) >> 30, (va & MASK_L1) >> 21,
 			  (va & MASK_L0) >> 12 };
-	pte_t entry;
 	pte_t *root = (void *)get_page_table_root();
 	pte_t tmp_entry;
 	uintptr_t tmp;
 	int i = 0;
 	while (1) {
-		// #ifdef EMODULE_GLOBAL_DEBUG
-		// 		printd("[S mode get_pa] i = %d, root = %p, OFFSET = 0x%lx\n", i,
-		// 		       root, ENC_VA_PA_OFFSET);
-		// #endif
 		tmp_entry = root[l[i]];
 		if (!tmp_entry.pte_v) {
 			em_debug("va:0x%lx is not valid!!!\n", va);
-			return 0;
+			return -1;
 		}
 		if ((tmp_entry.pte_r | tmp_entry.pte_w | tmp_entry.pte_x)) {
 			break;
 		}
+		if (i == 2)
+			return -1;
 		tmp  = tmp_entry.ppn << 12;
 		root = (pte_t *)(tmp + get_va_pa_offset());
 		i++;
 	}
-	if (i == 2)
-		return (tmp_entry.ppn << 12) | (va & 0xfff);
-	else if (i == 1)
-		return (tmp_entry.ppn >> 9) << 21 | (va & 0x1fffff);
-	else {
+	*leaf = tmp_entry;
+	return i;
+}
+
+static uintptr_t leaf_pa(pte_t entry, int level, uintptr_t va)
+{
+	if (level == 2)
+		return (entry.ppn << 12) | (va & 0xfff);
+	else if (level == 1)
+		return (entry.ppn >> 9) << 21 | (va & 0x1fffff);
+	return 0;
+}
+
+uintptr_t get_pa(uintptr_t va)
+{
+	pte_t entry;
+	int level = walk_leaf(va, &entry);
+
+	return level < 0 ? 0 : leaf_pa(entry, level, va);
+}
+
+/*
+ * Like `get_pa', for a VA handed in by user mode: 0 unless the page is
+ * user-accessible, and writable too when `write' is set.
+ */
+uintptr_t get_user_pa(uintptr_t va, int write)
+{
+	pte_t entry;
+	int level = walk_leaf(va, &entry);
+
+	if (level < 0 || !entry.pte_u || !entry.pte_r ||
+	    (write && !entry.pte_w))
 		return 0;
-	}
+	return leaf_pa(entry, level, va);
 }
 
 void test_va(uintptr_t va)
@@ -248,14 +274,29 @@ void map_page(uintptr_t va, uintptr_t pa, size_t n_pages, uintptr_t attr)
 	}
 }
 
+// Map 2 MiB pages, `va' and `pa' must both be megapage aligned
+void map_mega_page(uintptr_t va, uintptr_t pa, size_t n_mega_pages,
+		   uintptr_t attr)
+{
+	while (n_mega_pages > 0) {
+		page_directory_insert(va, pa, 2, attr);
+		va += EMEGA_PAGE_SIZE;
+		pa += EMEGA_PAGE_SIZE;
+		n_mega_pages--;
+	}
+
+	if (read_csr(satp)) {
+		flush_page_table_cache_and_tlb();
+	}
+}
+
 uintptr_t ioremap(pte_t *root, uintptr_t pa, size_t size)
 {
 	static uintptr_t drv_addr_alloc = 0;
 	em_debug("current root address: 0x%lx\n", get_page_table_root());
 	size_t n_pages = PAGE_UP(size) >> EPAGE_SHIFT;
-	map_page(EDRV_DRV_START + drv_addr_alloc, pa, n_pages,
-		 PTE_V | PTE_W | PTE_R | PTE_D | PTE_X);
-	uintptr_t cur_addr = EDRV_DRV_START;
+	uintptr_t cur_addr = EDRV_DRV_START + drv_addr_alloc;
+	map_page(cur_addr, pa, n_pages, PTE_V | PTE_W | PTE_R | PTE_D | PTE_X);
 	drv_addr_alloc += n_pages << 12;
 	return cur_addr;
 }
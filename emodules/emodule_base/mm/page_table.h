@@ -29,9 +29,12 @@ extern uintptr_t ENC_VA_PA_OFFSET;
 extern inverse_map_t inv_map[INVERSE_MAP_ENTRY_NUM];
 
 void map_page(uintptr_t va, uintptr_t pa, size_t n_pages, uintptr_t attr);
+void map_mega_page(uintptr_t va, uintptr_t pa, size_t n_mega_pages,
+		   uintptr_t attr);
 uintptr_t ioremap(pte_t *, uintptr_t, size_t);
 uintptr_t alloc_page(pte_t *, uintptr_t, uintptr_t, uintptr_t, char);
 uintptr_t get_pa(uintptr_t);
+uintptr_t get_user_pa(uintptr_t va, int write);
 void print_pte(uintptr_t va);
 void test_va(uintptr_t va);
 void set_page_table_root(uintptr_t pt_root);
@@ -1,7 +1,114 @@
 #pragma once
 #include <stdint.h>
+#include <sbi/ebi/ring.h>
 
 typedef uintptr_t (*cmd_handler)(uintptr_t cmd, uintptr_t arg0, uintptr_t arg1,
 				 uintptr_t arg2);
 
-#define QUERY_INFO -1
\ No newline at end of file
+#define QUERY_INFO -1
+#define CMD_SUBMIT -2 // (ring, 0, 0), returns the number of completions
+
+/*
+ * Batched command interface shared by all drivers. The caller queues
+ * descriptors in a `drv_ring_t' and hands the whole ring to the driver with
+ * one `CMD_SUBMIT' call; results come back in submission order in the CQ.
+ * The scalar `cmd_handler' call stays as a shim running a single descriptor.
+ */
+#define DRV_RING_ENTRIES 32
+
+typedef struct {
+	uintptr_t cmd;
+	uintptr_t arg[3];
+	uintptr_t user_data;
+} drv_desc_t;
+
+typedef struct {
+	uintptr_t user_data;
+	uintptr_t ret;
+} drv_cpl_t;
+
+typedef struct {
+	ebi_ring_t sq;
+	ebi_ring_t cq;
+	drv_desc_t desc[DRV_RING_ENTRIES];
+	drv_cpl_t cpl[DRV_RING_ENTRIES];
+} drv_ring_t;
+
+/* What a driver implements once, for both the ring and the shim */
+typedef uintptr_t (*drv_desc_handler)(const drv_desc_t *desc);
+
+static inline void drv_ring_init(drv_ring_t *ring)
+{
+	ebi_ring_init(&ring->sq, DRV_RING_ENTRIES);
+	ebi_ring_init(&ring->cq, DRV_RING_ENTRIES);
+}
+
+// Queue one command, -1 if the ring is full
+static inline int drv_ring_push(drv_ring_t *ring, uintptr_t cmd,
+				uintptr_t arg0, uintptr_t arg1, uintptr_t arg2,
+				uintptr_t user_data)
+{
+	drv_desc_t *desc;
+	int slot = ebi_ring_prod_slot(&ring->sq, DRV_RING_ENTRIES);
+
+	if (slot < 0)
+		return -1;
+	desc		= &ring->desc[slot];
+	desc->cmd	= cmd;
+	desc->arg[0]	= arg0;
+	desc->arg[1]	= arg1;
+	desc->arg[2]	= arg2;
+	desc->user_data = user_data;
+	ebi_ring_prod_commit(&ring->sq);
+	return 0;
+}
+
+// Take one completion, -1 if there is none
+static inline int drv_ring_pop(drv_ring_t *ring, drv_cpl_t *cpl)
+{
+	int slot = ebi_ring_cons_slot(&ring->cq, DRV_RING_ENTRIES);
+
+	if (slot < 0)
+		return -1;
+	cpl->user_data = ring->cpl[slot].user_data;
+	cpl->ret       = ring->cpl[slot].ret;
+	ebi_ring_cons_commit(&ring->cq);
+	return 0;
+}
+
+// Driver side of `CMD_SUBMIT', stops early when the CQ is full
+static inline uintptr_t drv_ring_run(drv_ring_t *ring, drv_desc_handler handler)
+{
+	uintptr_t n = 0;
+	int sq, cq;
+
+	while ((sq = ebi_ring_cons_slot(&ring->sq, DRV_RING_ENTRIES)) >= 0) {
+		cq = ebi_ring_prod_slot(&ring->cq, DRV_RING_ENTRIES);
+		if (cq < 0)
+			break;
+		ring->cpl[cq].user_data = ring->desc[sq].user_data;
+		ring->cpl[cq].ret	= handler(&ring->desc[sq]);
+		ebi_ring_cons_commit(&ring->sq);
+		ebi_ring_prod_commit(&ring->cq);
+		n++;
+	}
+	return n;
+}
+
+// Driver side of a scalar call, runs it as a single descriptor
+static inline uintptr_t drv_scalar_shim(drv_desc_handler handler,
+				       uintptr_t cmd, uintptr_t arg0,
+				       uintptr_t arg1, uintptr_t arg2)
+{
+	drv_desc_t desc;
+
+	if (cmd == CMD_SUBMIT)
+		return drv_ring_run((drv_ring_t *)arg0, handler);
+
+	desc.cmd       = cmd;
+	desc.arg[0]    = arg0;
+	desc.arg[1]    = arg1;
+	desc.arg[2]    = arg2;
+	desc.user_data = 0;
+	return handler(&desc);
+}
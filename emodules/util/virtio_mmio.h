@@ -0,0 +1,95 @@
+#pragma once
+#include <stdint.h>
+
+/* virtio-mmio transport, legacy (version 1) and modern (version 2) */
+#define VIRTIO_MMIO_MAGIC_VALUE 0x000
+#define VIRTIO_MMIO_VERSION 0x004
+#define VIRTIO_MMIO_DEVICE_ID 0x008
+#define VIRTIO_MMIO_VENDOR_ID 0x00c
+#define VIRTIO_MMIO_DEVICE_FEATURES 0x010
+#define VIRTIO_MMIO_DEVICE_FEATURES_SEL 0x014
+#define VIRTIO_MMIO_DRIVER_FEATURES 0x020
+#define VIRTIO_MMIO_DRIVER_FEATURES_SEL 0x024
+#define VIRTIO_MMIO_GUEST_PAGE_SIZE 0x028 // legacy only
+#define VIRTIO_MMIO_QUEUE_SEL 0x030
+#define VIRTIO_MMIO_QUEUE_NUM_MAX 0x034
+#define VIRTIO_MMIO_QUEUE_NUM 0x038
+#define VIRTIO_MMIO_QUEUE_ALIGN 0x03c // legacy only
+#define VIRTIO_MMIO_QUEUE_PFN 0x040 // legacy only
+#define VIRTIO_MMIO_QUEUE_READY 0x044
+#define VIRTIO_MMIO_QUEUE_NOTIFY 0x050
+#define VIRTIO_MMIO_INTERRUPT_STATUS 0x060
+#define VIRTIO_MMIO_INTERRUPT_ACK 0x064
+#define VIRTIO_MMIO_STATUS 0x070
+#define VIRTIO_MMIO_QUEUE_DESC_LOW 0x080
+#define VIRTIO_MMIO_QUEUE_DESC_HIGH 0x084
+#define VIRTIO_MMIO_QUEUE_AVAIL_LOW 0x090
+#define VIRTIO_MMIO_QUEUE_AVAIL_HIGH 0x094
+#define VIRTIO_MMIO_QUEUE_USED_LOW 0x0a0
+#define VIRTIO_MMIO_QUEUE_USED_HIGH 0x0a4
+#define VIRTIO_MMIO_CONFIG 0x100
+
+#define VIRTIO_MMIO_MAGIC 0x74726976 // "virt"
+#define VIRTIO_MMIO_SLOT_SIZE 0x1000
+
+#define VIRTIO_ID_NET 1
+#define VIRTIO_ID_BLOCK 2
+#define VIRTIO_ID_CONSOLE 3
+
+#define VIRTIO_STATUS_ACKNOWLEDGE 0x01
+#define VIRTIO_STATUS_DRIVER 0x02
+#define VIRTIO_STATUS_DRIVER_OK 0x04
+#define VIRTIO_STATUS_FEATURES_OK 0x08
+#define VIRTIO_STATUS_FAILED 0x80
+
+#define VIRTIO_F_VERSION_1 32
+
+#define VRING_DESC_F_NEXT 1
+#define VRING_DESC_F_WRITE 2
+
+/* Set by the device in `vring_used.flags' while it is still polling */
+#define VRING_USED_F_NO_NOTIFY 1
+
+/* Used ring alignment for legacy devices, any power of two is allowed */
+#define VRING_USED_ALIGN 16
+
+struct vring_desc {
+	uint64_t addr;
+	uint32_t len;
+	uint16_t flags;
+	uint16_t next;
+};
+
+struct vring_avail {
+	uint16_t flags;
+	uint16_t idx;
+	uint16_t ring[];
+};
+
+struct vring_used_elem {
+	uint32_t id;
+	uint32_t len;
+};
+
+struct vring_used {
+	uint16_t flags;
+	uint16_t idx;
+	struct vring_used_elem ring[];
+};
+
+/* Byte offsets of the three parts when laid out back to back */
+#define VRING_AVAIL_OFFSET(num) ((num) * sizeof(struct vring_desc))
+#define VRING_USED_OFFSET(num)                                                \
+	((VRING_AVAIL_OFFSET(num) + sizeof(uint16_t) * (3 + (num)) +           \
+	  VRING_USED_ALIGN - 1) &                                              \
+	 ~(VRING_USED_ALIGN - 1))
+#define VRING_SIZE(num)                                                       \
+	(VRING_USED_OFFSET(num) + sizeof(uint16_t) * 3 +                      \
+	 sizeof(struct vring_used_elem) * (num))
+
+/* Translates enclave VAs for the device, provided by the base module */
+typedef uintptr_t (*va_to_pa_t)(uintptr_t va);
+
+#define virtio_mb() asm volatile("fence iorw, iorw" ::: "memory")
+#define virtio_wmb() asm volatile("fence w, w" ::: "memory")
+#define virtio_rmb() asm volatile("fence r, r" ::: "memory")
@@ -0,0 +1,48 @@
+#ifndef EBI_CHANNEL_H
+#define EBI_CHANNEL_H
+
+#include <sbi/ebi/enclave.h>
+
+/*
+ * Enclave-to-enclave channels. Both enclaves open the channel naming each
+ * other; the first call allocates one pool section and the second one joins
+ * it, so the host is never asked to agree. Each side maps the section into
+ * its own page table. The monitor only keeps the section alive until both
+ * sides are gone and rings doorbells:
+ *
+ *   - `SBI_EXT_EBI_CHAN_NOTIFY' sets the channel's bit in the peer's
+ *     doorbell mask. A peer running on a hart also gets an S-mode software
+ *     interrupt, to get it out of `wfi'.
+ *   - `SBI_EXT_EBI_CHAN_WAIT' takes the caller's doorbells. With none rung
+ *     and `block' set, it suspends the caller to the host like
+ *     `SBI_EXT_EBI_SUSPEND'.
+ *   - `SBI_EXT_EBI_CHAN_POLL' lets the host read any enclave's mask. A
+ *     suspended enclave with a non-zero mask is runnable.
+ *
+ * Channel sections belong to `CHAN_OWNER', never to either enclave, so
+ * section migration and compaction leave them where both page tables
+ * expect them.
+ */
+#define CHAN_MAX 64 // one bit each in `chan_bell'
+
+#define CHAN_FREE 0
+#define CHAN_PENDING 1 // opened by eid[0], waiting for eid[1]
+#define CHAN_OPEN 2
+
+#ifndef __ASSEMBLER__
+
+typedef struct {
+	int state;
+	int eid[2]; // endpoints, -1 once a side has left
+	uintptr_t sfn; // shared section
+} channel_t;
+
+void init_channels(void);
+uintptr_t channel_open(enclave_context_t *ectx, uintptr_t peer,
+		       struct sbi_trap_regs *regs);
+uintptr_t channel_notify(enclave_context_t *ectx, uintptr_t id);
+uintptr_t channel_take_bells(enclave_context_t *ectx);
+void channel_close_all(enclave_context_t *ectx);
+
+#endif // __ASSEMBLER__
+#endif // EBI_CHANNEL_H
@@ -4,6 +4,12 @@
 #include <sbi/ebi/util.h>
 
 #define MAX_DRV 64
+
+/* Index of each driver in `__drv_addr_list' and bit in `drv_mask' */
+#define DRV_ID_CONSOLE 0
+#define DRV_ID_RTC 1 // reserved, no driver yet
+#define DRV_ID_VIRTIO_BLK 2
+#define DRV_ID_VIRTIO_CONSOLE 3
 #define CMD_QUERY_INFO -1
 
 #ifndef __ASSEMBLER__
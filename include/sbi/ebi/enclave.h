@@ -3,15 +3,27 @@
 
 #include <sbi/ebi/util.h>
 #include <sbi/ebi/drv.h>
+#include <sbi/ebi/thread.h>
 
 #define PERI_NUM_MAX 128
+/*
+ * Host sections donated to one enclave as a shared window. The host keeps
+ * ownership, so they are never migrated, compacted or zeroed.
+ */
+#define SHM_MAX_SECTIONS 64 // 512 MiB of 8 MiB sections
 
 #define NUM_ENCLAVE 180
 #define NUM_CORES 10
 
+/* `launch_done_t.state', see `SBI_EXT_EBI_LAUNCH' */
+#define LAUNCH_RUNNING 0
+#define LAUNCH_SUSPENDED 1
+#define LAUNCH_EXITED 2
+
 #ifndef __ASSEMBLER__
 
 #include <sbi/riscv_locks.h>
+#include <sbi/sbi_scratch.h>
 typedef enum {
 	ENC_FREE, // Unused/unloaded
 	ENC_LOAD, // Loaded, but not started
@@ -19,6 +31,33 @@ typedef enum {
 	ENC_RUN	  // Running
 } enclave_status_t;
 
+/*
+ * Secondary thread of an enclave. It shares the address space and the
+ * sections of the main thread, whose hart state stays in the `ns_*' fields
+ * of the enclave context. A thread goes straight from its start state to a
+ * hart and never suspends, so the start state is all that is kept.
+ */
+typedef struct {
+	enclave_status_t status; // ENC_LOAD until it is on a hart
+	uint32_t hart;
+	thread_desc_t desc;
+	// S-mode state copied from the creating thread
+	uintptr_t ns_satp;
+	uintptr_t ns_mstatus;
+	uintptr_t ns_medeleg;
+	uintptr_t ns_sstatus;
+	uintptr_t ns_stvec;
+	uintptr_t ns_sie;
+} enclave_thread_t;
+
+/* Time slicing of an enclave, see <sbi/ebi/sched.h> */
+typedef struct {
+	int hart; // hart it is sliced on, -1 if never preempted
+	uint32_t prio; // 0 is the most urgent
+	uint32_t quantum_us; // slice length
+	int preempted; // suspended by the scheduler, not by itself
+} enclave_sched_t;
+
 typedef struct {
 	uintptr_t id;
 
@@ -32,6 +71,7 @@ typedef struct {
 	uintptr_t ns_sscratch;
 	uintptr_t ns_sie;
 	uintptr_t ns_sepc;
+	uint64_t ns_stimecmp; // S-mode timer compare with Sstc, -1 if none
 
 	uintptr_t pa;
 	uintptr_t mem_size;
@@ -49,10 +89,37 @@ typedef struct {
 	uintptr_t offset_addr;
 
 	pmp_region pmp_reg[PMP_REGION_MAX];
+
+	// Shared window donated by the host, in enclave VA order
+	uintptr_t shm_sfn[SHM_MAX_SECTIONS];
+	uintptr_t shm_cnt;
+	// Switchless call slots inside the window, 0 if not set up
+	uintptr_t sl_ring_pa;
+	uintptr_t sl_ring_off;
+	// OCALL area inside the window, 0 if not set up
+	uintptr_t oc_area_pa;
+	uintptr_t oc_area_off;
+	// Doorbells rung on this enclave's channels, one bit per channel ID
+	uint64_t chan_bell;
+	// Secondary threads, `threads[tid - 1]'
+	enclave_thread_t threads[ENC_THREAD_MAX];
+	uint32_t n_threads; // created and not exited yet
+	enclave_sched_t sched;
 } enclave_context_t;
 
+/*
+ * Completion record of an asynchronous launch, in host memory. The hart
+ * running the enclave stores `ret' and then `state', and sends the
+ * launching hart an S-mode software interrupt.
+ */
+typedef struct {
+	uint64_t state;
+	uint64_t ret; // exit value once LAUNCH_EXITED
+} launch_done_t;
+
 extern enclave_context_t enclaves[NUM_ENCLAVE + 1];
 extern int enclave_on_core[NUM_CORES];
+extern int thread_on_core[NUM_CORES]; // 0 for the main thread
 extern spinlock_t enclave_lock, core_lock;
 
 extern void init_enclaves(void);
@@ -61,9 +128,23 @@ extern uintptr_t enter_enclave(struct sbi_trap_regs *args, uintptr_t mepc);
 extern uintptr_t exit_enclave(struct sbi_trap_regs *regs);
 extern uintptr_t suspend_enclave(uintptr_t id, struct sbi_trap_regs *regs, uintptr_t mepc);
 extern uintptr_t resume_enclave(uintptr_t id, struct sbi_trap_regs *regs);
+extern uintptr_t launch_enclave(struct sbi_trap_regs *regs, uintptr_t mepc);
+extern void launch_run(struct sbi_scratch *scratch, u32 hartid);
+extern void return_to_host(struct sbi_trap_regs *regs);
+extern uintptr_t thread_create(enclave_context_t *ectx,
+			       struct sbi_trap_regs *regs, uintptr_t mepc);
+extern uintptr_t thread_exit(enclave_context_t *ectx);
+extern void enclave_rebase_threads(enclave_context_t *ectx, uintptr_t satp);
+extern uintptr_t enclave_stop_local(uintptr_t eid, int kill,
+				    struct sbi_trap_regs *regs);
+extern uintptr_t enclave_reap(enclave_context_t *ectx);
 enclave_context_t *eid_to_context(uintptr_t eid);
 int enclave_num();
 int check_alive(uintptr_t eid);
+uintptr_t switchless_setup(enclave_context_t *ectx, uintptr_t off);
+uintptr_t switchless_teardown(enclave_context_t *ectx);
+uintptr_t ocall_setup(enclave_context_t *ectx, uintptr_t off);
+void ocall_teardown(enclave_context_t *ectx);
 
 #endif // __ASSEMBLER__
 
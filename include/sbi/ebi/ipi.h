@@ -0,0 +1,40 @@
+#ifndef EBI_IPI_H
+#define EBI_IPI_H
+
+#include <sbi/ebi/enclave.h>
+
+/*
+ * Control of an enclave on the other harts running it, through an EBI IPI
+ * event. One request is in flight at a time: the sender names the enclave,
+ * the harts running it at that moment get the IPI, and each of them acks
+ * once it has handled it. Harts running something else are left alone.
+ *
+ *   - EBI_IPI_SUSPEND: suspend the enclave like `SBI_EXT_EBI_SUSPEND'.
+ *     Only its main thread can be suspended.
+ *   - EBI_IPI_KILL: drop the enclave, the host's ENTER or RESUME returns
+ *     EBI_ERROR. The sender frees it once every hart acked. Sent by an
+ *     exiting main thread, it ends the secondary threads only.
+ *   - EBI_IPI_HOLD: park the hart until the sender releases it, then
+ *     switch to the new page table root if one is given and flush the
+ *     TLB. Section migration holds the owner's harts over the copy.
+ *
+ * A hart that starts running a held enclave parks as well. A hart waiting
+ * for the request lock handles requests meanwhile, without its trap
+ * context, so it fails SUSPEND and KILL.
+ */
+#define EBI_IPI_SUSPEND 1
+#define EBI_IPI_KILL 2
+#define EBI_IPI_HOLD 3
+
+#ifndef __ASSEMBLER__
+
+int init_ebi_ipi(void);
+uintptr_t ebi_ipi_stop(uintptr_t eid, int kill);
+uintptr_t ebi_ipi_kill_threads(uintptr_t eid);
+void ebi_ipi_hold(uintptr_t eid);
+void ebi_ipi_release(uintptr_t satp);
+void ebi_ipi_wait_held(uintptr_t eid);
+void ebi_ipi_ack(uintptr_t result);
+
+#endif // __ASSEMBLER__
+#endif // EBI_IPI_H
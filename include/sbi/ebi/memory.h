@@ -79,8 +79,14 @@ typedef struct section {
 	uintptr_t sfn; // section frame number
 	int owner;     // enclave id of the owner. -1 if unused.
 	uintptr_t va;  // linearly mapped addr of the section
+	int share;     // enclave id the host shares it with. -1 if private.
 } section_t;
 
+/* Owner of enclave-to-enclave channel sections, mapped by two enclaves */
+#define CHAN_OWNER (NUM_ENCLAVE + 1)
+/* Owner of a section claimed as the destination of a migration */
+#define MIGRATE_OWNER (NUM_ENCLAVE + 2)
+
 extern section_t memory_pool[MEMORY_POOL_SECTION_NUM];
 extern spinlock_t memory_pool_lock;
 
@@ -96,8 +102,14 @@ void init_memory_pool(void);
 uintptr_t alloc_section_for_enclave(enclave_context_t *ectx, uintptr_t va);
 void free_section_for_enclave(int eid);
 int section_migration(uintptr_t src_sfn, uintptr_t dst_sfn);
+uintptr_t share_sections_with_enclave(enclave_context_t *ectx,
+				     uintptr_t pa_list, uintptr_t count,
+				     uintptr_t mepc);
+void unshare_sections_of_enclave(enclave_context_t *ectx);
 void memcpy_from_user(uintptr_t maddr, uintptr_t uaddr, uintptr_t size,
 		      uintptr_t mepc);
+void memcpy_to_user(uintptr_t uaddr, uintptr_t maddr, uintptr_t size,
+		    uintptr_t mepc);
 void debug_memdump(uintptr_t addr, size_t size);
 
 #endif // __ASSEMBLER__
@@ -28,8 +28,13 @@ typedef struct {
 uint8_t load_uint8_t(const uint8_t *addr, uintptr_t mepc);
 uint32_t load_uint32_t(const uint32_t *addr, uintptr_t mepc);
 uint64_t load_uint64_t(const uint64_t *addr, uintptr_t mepc);
+void store_uint8_t(uint8_t *addr, uint8_t val, uintptr_t mepc);
+void store_uint32_t(uint32_t *addr, uint32_t val, uintptr_t mepc);
+void store_uint64_t(uint64_t *addr, uint64_t val, uintptr_t mepc);
 
 section_t *find_available_section();
+section_t *claim_available_section(int owner, uintptr_t va);
+int claim_section(uintptr_t sfn, int owner, uintptr_t va);
 uintptr_t alloc_section_for_host_os();
 int get_avail_pmp_count(enclave_context_t *ectx);
 region_t find_largest_avail();
@@ -39,7 +44,6 @@ void page_compaction(void);
 void update_tree_pte(uintptr_t root, uintptr_t pa_diff);
 void update_leaf_pte(uintptr_t root, uintptr_t va, uintptr_t pa);
 void set_section_zero(uintptr_t sfn);
-void update_section_info(uintptr_t sfn, int owner, uintptr_t va);
 void free_section(uintptr_t sfn);
 
 #endif // EBI_MEMUTIL_H
\ No newline at end of file
@@ -1,6 +1,13 @@
 #ifndef EBI_MONITOR_H
 #define EBI_MONITOR_H
 
+#include <sbi/ebi/util.h>
+
+/* Bytes copied out of the enclave per console write, bounded for M-mode */
+#define EBI_PUTS_CHUNK 256
+#define EBI_PUTS_MAX 4096
+
 void dump_enclave_status();
+uintptr_t enclave_puts(uintptr_t va, uintptr_t len, uintptr_t mepc);
 
 #endif // EBI_MONITOR_H
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef EBI_OCALL_H
+#define EBI_OCALL_H
+
+#include <sbi/ebi/switchless.h>
+
+/*
+ * Host-proxied I/O. The base module forwards file syscalls on host file
+ * descriptors (fd > 2) as OCALLs: it posts them in `ring' of an area in the
+ * shared window and a host helper runs them. Bulk data never goes through
+ * registers, buffer arguments are window offsets, either of the caller's
+ * own buffer when it already is in the window or of the slot's bounce
+ * buffer right after the area header.
+ *
+ * With `helper' set, a host thread polls the ring on another hart and the
+ * enclave just spins on its slot. Otherwise the enclave suspends after
+ * posting; the host finds the posted slot when ENTER/RESUME returns, runs
+ * it, and resumes the enclave.
+ *
+ * Results follow the Linux convention: >= 0 on success, -errno on failure.
+ */
+#define OCALL_OPENAT 1 // (dirfd, path_off, flags, mode)
+#define OCALL_CLOSE 2 // (fd)
+#define OCALL_READ 3 // (fd, buf_off, len)
+#define OCALL_WRITE 4 // (fd, buf_off, len)
+#define OCALL_LSEEK 5 // (fd, offset, whence)
+
+#define OCALL_BUF_SIZE 0x10000 // bounce buffer of each slot
+#define OCALL_AREA_SIZE (sizeof(ocall_area_t) + SL_SLOTS * OCALL_BUF_SIZE)
+
+#ifndef __ASSEMBLER__
+
+typedef struct {
+	sl_ring_t ring; // the enclave posts, the host helper serves
+	uint32_t helper; // set while a host thread polls `ring'
+	uint32_t n_sync; // OCALLs that suspended the enclave
+} __attribute__((aligned(64))) ocall_area_t;
+
+/* Window offset of the bounce buffer of `slot' in the area at `area_off' */
+#define OCALL_BUF_OFF(area_off, slot) \
+	((area_off) + sizeof(ocall_area_t) + (slot)*OCALL_BUF_SIZE)
+
+#endif // __ASSEMBLER__
+#endif // EBI_OCALL_H
@@ -0,0 +1,84 @@
+#ifndef EBI_RING_H
+#define EBI_RING_H
+
+#include <sbi/ebi/util.h>
+
+#ifndef __ASSEMBLER__
+
+/*
+ * Single-producer single-consumer ring indices shared across privilege
+ * levels (or enclaves). Only the indices live here, the slots sit next to
+ * the header in whatever memory both sides map. `head' is written by the
+ * consumer only, `tail' by the producer only. The indices run freely and
+ * are masked on use, so the slot count must be a power of two.
+ *
+ * The header sits in memory the other side can write, so `mask' is only
+ * informative: each side passes the slot count it allocated itself, and
+ * indices more than that many slots apart are taken as an empty (or full)
+ * ring, before any slot is touched.
+ */
+typedef struct {
+	uint32_t head;
+	uint32_t tail;
+	uint32_t mask;
+	uint32_t flags;
+} ebi_ring_t;
+
+static inline void ebi_ring_init(ebi_ring_t *r, uint32_t size)
+{
+	r->head	 = 0;
+	r->tail	 = 0;
+	r->mask	 = size - 1;
+	r->flags = 0;
+}
+
+static inline uint32_t ebi_ring_count(const ebi_ring_t *r)
+{
+	return __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) -
+	       __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+}
+
+/* Free slots of a ring of `size' slots, 0 if its indices are bogus */
+static inline uint32_t ebi_ring_space(const ebi_ring_t *r, uint32_t size)
+{
+	uint32_t count = ebi_ring_count(r);
+
+	return count > size ? 0 : size - count;
+}
+
+/* Producer: slot to fill, or -1 if the ring is full */
+static inline int ebi_ring_prod_slot(ebi_ring_t *r, uint32_t size)
+{
+	uint32_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+	uint32_t tail = r->tail;
+
+	if (tail - head >= size)
+		return -1;
+	return tail & (size - 1);
+}
+
+/* Producer: publish the slot filled after `ebi_ring_prod_slot' */
+static inline void ebi_ring_prod_commit(ebi_ring_t *r)
+{
+	__atomic_store_n(&r->tail, r->tail + 1, __ATOMIC_RELEASE);
+}
+
+/* Consumer: slot to read, or -1 if the ring is empty */
+static inline int ebi_ring_cons_slot(ebi_ring_t *r, uint32_t size)
+{
+	uint32_t tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+	uint32_t head = r->head;
+
+	if (tail == head || tail - head > size)
+		return -1;
+	return head & (size - 1);
+}
+
+/* Consumer: hand the slot read after `ebi_ring_cons_slot' back */
+static inline void ebi_ring_cons_commit(ebi_ring_t *r)
+{
+	__atomic_store_n(&r->head, r->head + 1, __ATOMIC_RELEASE);
+}
+
+#endif // __ASSEMBLER__
+#endif // EBI_RING_H
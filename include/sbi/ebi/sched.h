@@ -0,0 +1,37 @@
+#ifndef EBI_SCHED_H
+#define EBI_SCHED_H
+
+#include <sbi/ebi/enclave.h>
+
+/*
+ * Time slicing of the enclaves the host assigned to a hart with
+ * `SBI_EXT_EBI_SCHED_SET'. While such an enclave runs on its hart, a
+ * firmware timer event ends its slice after `quantum'. The scheduler then
+ * picks, among the enclaves it preempted on that hart and the host if it
+ * is waiting for the hart, the most urgent one, round robin within a
+ * priority. A running enclave more urgent than all of them keeps the hart
+ * for another slice.
+ *
+ * A preempted enclave is `ENC_IDLE' like a suspended one and the host may
+ * resume it itself. Enclaves that suspend on their own go back to the host
+ * as before; the scheduler never resumes them. The host is never
+ * preempted, it only gets its turn when a slice ends, so an enclave more
+ * urgent than the host keeps it waiting. Harts from `SBI_EXT_EBI_LAUNCH'
+ * and secondary threads are not sliced.
+ */
+#define SCHED_PRIO_LEVELS 8
+#define SCHED_PRIO_DEFAULT 4
+#define SCHED_QUANTUM_US 10000 // default slice, 10 ms
+#define SCHED_QUANTUM_MIN_US 100
+
+#ifndef __ASSEMBLER__
+
+void init_sched(void);
+void sched_init_enclave(enclave_context_t *ectx);
+uintptr_t sched_set(uintptr_t eid, uintptr_t hart, uintptr_t prio,
+		    uintptr_t quantum_us);
+void sched_arm(enclave_context_t *ectx);
+void sched_disarm(void);
+
+#endif // __ASSEMBLER__
+#endif // EBI_SCHED_H
@@ -0,0 +1,69 @@
+#ifndef EBI_STATS_H
+#define EBI_STATS_H
+
+#include <sbi/ebi/util.h>
+
+/*
+ * Counters kept by the monitor, read by the host with `SBI_EXT_EBI_STATS'
+ * into a buffer of its own. The buffer holds an `ebi_stats_t' followed by
+ * `n_enclaves' entries of `ebi_enclave_stat_t', one per live enclave and
+ * one for the host (eid 0). Cycle counts are `mcycle' deltas on the hart
+ * that did the work.
+ */
+#define EBI_STATS_MAGIC 0x73746174 // "stat"
+#define EBI_STATS_VERSION 1
+
+/* Timed operations, indices of `ebi_stats_t.op' */
+#define EBI_STAT_CREATE 0
+#define EBI_STAT_ENTER 1
+#define EBI_STAT_EXIT 2
+#define EBI_STAT_SUSPEND 3
+#define EBI_STAT_RESUME 4
+#define EBI_STAT_MEM_ALLOC 5
+#define EBI_STAT_MIGRATION 6
+#define EBI_STAT_COMPACTION 7
+#define EBI_STAT_OP_MAX 8
+
+#ifndef __ASSEMBLER__
+#include <sbi/riscv_asm.h>
+
+typedef struct {
+	uint64_t count;
+	uint64_t total; // cycles
+	uint64_t max; // cycles
+} ebi_op_stat_t;
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t n_ops;
+	uint32_t n_enclaves; // entries that follow
+	ebi_op_stat_t op[EBI_STAT_OP_MAX];
+	/* Memory pool, in sections */
+	uint32_t pool_sections;
+	uint32_t pool_free;
+	uint32_t pool_free_runs; // maximal runs of free sections
+	uint32_t pool_largest_run;
+} ebi_stats_t;
+
+/* 8-byte aligned, it is copied out a doubleword at a time */
+typedef struct {
+	uint32_t eid;
+	uint32_t status;
+	uint32_t sections; // pool sections it owns now
+	uint32_t migrations; // of its sections since it was created
+} __attribute__((aligned(8))) ebi_enclave_stat_t;
+
+static inline uint64_t stats_start(void)
+{
+	return csr_read(CSR_MCYCLE);
+}
+
+void stats_end(int op, uint64_t start);
+void stats_migrated(uintptr_t eid);
+void stats_enclave_reset(uintptr_t eid);
+uintptr_t stats_copy_to_host(uintptr_t va, uintptr_t len, uintptr_t reset,
+			     struct sbi_trap_regs *regs, uintptr_t mepc);
+
+#endif // __ASSEMBLER__
+#endif // EBI_STATS_H
@@ -0,0 +1,129 @@
+#ifndef EBI_SWITCHLESS_H
+#define EBI_SWITCHLESS_H
+
+#include <sbi/ebi/util.h>
+
+/*
+ * Switchless calls between the host and an enclave. The call slots live in
+ * the shared window (see `SBI_EXT_EBI_SHARE'), so both sides talk through
+ * memory only. Callers claim a slot, fill it and spin on it until a worker
+ * has stored the result. For calls into the enclave the host is the caller
+ * and enclave harts poll the slots from U-mode; OCALLs (see ocall.h) run
+ * the other way round. The monitor is only involved to set the slots up
+ * and to raise `stop' at teardown.
+ *
+ * Slot life cycle:
+ *   SL_FREE --caller--> SL_HOST --caller--> SL_POSTED --worker-->
+ *   SL_CLAIMED --worker--> SL_DONE --caller--> SL_FREE
+ */
+#define SL_MAGIC 0x736c7373 // "slss"
+#define SL_SLOTS 64
+#define SL_ARGS 6
+
+#define SL_FREE 0
+#define SL_HOST 1 // claimed by a caller, being filled
+#define SL_POSTED 2
+#define SL_CLAIMED 3 // picked up by a worker
+#define SL_DONE 4
+
+#ifndef __ASSEMBLER__
+
+/* Forced, the enclave worker loop runs in `.text.ulib' even at -O0 */
+#define __sl_inline static inline __attribute__((always_inline))
+
+/* One cache line per slot, a worker and a caller only share their own */
+typedef struct {
+	uint32_t state;
+	uint32_t func;
+	uint64_t args[SL_ARGS];
+	int64_t ret;
+} __attribute__((aligned(64))) sl_slot_t;
+
+typedef struct {
+	uint32_t magic;
+	uint32_t n_slots;
+	uint32_t stop; // set by the monitor, workers leave their loop
+	uint32_t n_workers; // workers currently polling
+	uint64_t ticket; // callers take slots in ticket order
+	uint64_t n_calls; // calls served since setup
+	sl_slot_t slot[SL_SLOTS];
+} __attribute__((aligned(64))) sl_ring_t;
+
+/* Caller: claim a free slot to fill, -1 after teardown */
+__sl_inline int sl_call_claim(sl_ring_t *ring)
+{
+	uint32_t expected;
+	sl_slot_t *slot;
+	int idx;
+
+	idx  = __atomic_fetch_add(&ring->ticket, 1, __ATOMIC_RELAXED) %
+	       SL_SLOTS;
+	slot = &ring->slot[idx];
+	do {
+		if (__atomic_load_n(&ring->stop, __ATOMIC_ACQUIRE))
+			return -1;
+		expected = SL_FREE;
+	} while (!__atomic_compare_exchange_n(&slot->state, &expected,
+					      SL_HOST, 0, __ATOMIC_ACQUIRE,
+					      __ATOMIC_RELAXED));
+	return idx;
+}
+
+/* Caller: hand a claimed slot to the workers */
+__sl_inline void sl_call_submit(sl_ring_t *ring, int idx, uint32_t func,
+				const uint64_t *args)
+{
+	sl_slot_t *slot = &ring->slot[idx];
+	int i;
+
+	slot->func = func;
+	for (i = 0; i < SL_ARGS; i++)
+		slot->args[i] = args ? args[i] : 0;
+	__atomic_store_n(&slot->state, SL_POSTED, __ATOMIC_RELEASE);
+}
+
+/* Caller: post a call, returns the slot to wait on or -1 after teardown */
+__sl_inline int sl_call_post(sl_ring_t *ring, uint32_t func,
+			     const uint64_t *args)
+{
+	int idx = sl_call_claim(ring);
+
+	if (idx >= 0)
+		sl_call_submit(ring, idx, func, args);
+	return idx;
+}
+
+/* Caller: spin until the call in `idx' is done, then free the slot */
+__sl_inline int64_t sl_call_wait(sl_ring_t *ring, int idx)
+{
+	sl_slot_t *slot = &ring->slot[idx];
+	int64_t ret;
+
+	while (__atomic_load_n(&slot->state, __ATOMIC_ACQUIRE) != SL_DONE)
+		;
+	ret = slot->ret;
+	__atomic_store_n(&slot->state, SL_FREE, __ATOMIC_RELEASE);
+	return ret;
+}
+
+/* Worker: take the call in `slot' if it is posted, 0 if somebody else did */
+__sl_inline int sl_slot_claim(sl_slot_t *slot)
+{
+	uint32_t expected = SL_POSTED;
+
+	if (__atomic_load_n(&slot->state, __ATOMIC_RELAXED) != SL_POSTED)
+		return 0;
+	return __atomic_compare_exchange_n(&slot->state, &expected,
+					   SL_CLAIMED, 0, __ATOMIC_ACQUIRE,
+					   __ATOMIC_RELAXED);
+}
+
+/* Worker: publish the result of a claimed slot */
+__sl_inline void sl_slot_done(sl_slot_t *slot, int64_t ret)
+{
+	slot->ret = ret;
+	__atomic_store_n(&slot->state, SL_DONE, __ATOMIC_RELEASE);
+}
+
+#endif // __ASSEMBLER__
+#endif // EBI_SWITCHLESS_H
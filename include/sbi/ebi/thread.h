@@ -0,0 +1,25 @@
+#ifndef EBI_THREAD_H
+#define EBI_THREAD_H
+
+#include <sbi/ebi/util.h>
+
+/*
+ * Secondary enclave threads, shared with the base module. The base module
+ * picks the thread ID and the kernel stack, the monitor picks a stopped
+ * hart and starts the thread there in U-mode. Thread 0 is the main one.
+ */
+#define ENC_THREAD_MAX 8 // threads next to the main one, IDs 1 to 8
+
+#ifndef __ASSEMBLER__
+
+/* Argument of `SBI_EXT_EBI_THREAD_CREATE', in base module memory */
+typedef struct {
+	uintptr_t tid; // 1 to ENC_THREAD_MAX
+	uintptr_t entry; // user PC
+	uintptr_t sp, gp, tp;
+	uintptr_t arg; // in a0
+	uintptr_t kstack; // base module stack for its traps, in sscratch
+} thread_desc_t;
+
+#endif // __ASSEMBLER__
+#endif // EBI_THREAD_H
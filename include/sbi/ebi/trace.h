@@ -0,0 +1,76 @@
+#ifndef EBI_TRACE_H
+#define EBI_TRACE_H
+
+#include <sbi/ebi/util.h>
+
+/*
+ * Binary trace of monitor events. Each hart appends fixed-size records to
+ * its own ring, so recording takes no lock and never touches the console;
+ * the oldest records are overwritten. `trace_dump' decodes the rings later,
+ * on demand (`SBI_EXT_EBI_DEBUG' 9). Events are grouped in classes that
+ * are switched on and off at runtime through `trace_mask' (debug 8).
+ *
+ * Record life cycle, per slot:
+ *   seq = 0 --writer--> payload --writer--> seq = index + 1
+ * A reader keeps a record only if `seq' is the expected one before and
+ * after copying it.
+ */
+#define TRACE_RING_SIZE 64 // records per hart, a power of two
+#define TRACE_ARGS 4
+
+/* Event classes, bits of `trace_mask' */
+#define TRACE_ECALL (1U << 0) // every EBI call and its result
+#define TRACE_ENCLAVE (1U << 1) // enclave life cycle
+#define TRACE_MEM (1U << 2) // sections given and taken back
+#define TRACE_SCHED (1U << 3) // slices handed over
+#define TRACE_ALL 0xfU
+
+#define TRACE_DEFAULT (TRACE_ENCLAVE | TRACE_MEM | TRACE_SCHED)
+
+/* Event IDs, see `trace_events' in trace.c for their arguments */
+#define TRACE_EV_EBI_CALL 0
+#define TRACE_EV_EBI_RET 1
+#define TRACE_EV_CREATE 2
+#define TRACE_EV_ENTER 3
+#define TRACE_EV_EXIT 4
+#define TRACE_EV_SUSPEND 5
+#define TRACE_EV_RESUME 6
+#define TRACE_EV_SEC_ALLOC 7
+#define TRACE_EV_SEC_FREE 8
+#define TRACE_EV_COMPACT 9
+#define TRACE_EV_SCHED 10
+#define TRACE_EV_MAX 11
+
+#ifndef __ASSEMBLER__
+
+typedef struct {
+	uint64_t time; // `sbi_timer_value', comparable across harts
+	uint64_t seq; // index in the ring + 1, 0 while being written
+	uint16_t hart;
+	uint16_t event;
+	uint32_t pad;
+	uint64_t arg[TRACE_ARGS];
+} __attribute__((aligned(64))) trace_rec_t;
+
+typedef struct {
+	uint64_t head; // records written so far
+	trace_rec_t rec[TRACE_RING_SIZE];
+} trace_ring_t;
+
+extern uint32_t trace_mask;
+
+void trace_record(uint32_t event, uintptr_t a0, uintptr_t a1, uintptr_t a2,
+		  uintptr_t a3);
+uint32_t trace_set_mask(uint32_t mask);
+void trace_dump(uintptr_t hart);
+
+/* Record `event' if its class is on, otherwise a load and a branch */
+#define ebi_trace(cls, event, a0, a1, a2, a3)                               \
+	do {                                                                \
+		if (unlikely(__atomic_load_n(&trace_mask, __ATOMIC_RELAXED) & \
+			     (cls)))                                        \
+			trace_record((event), (a0), (a1), (a2), (a3));      \
+	} while (0)
+
+#endif // __ASSEMBLER__
+#endif // EBI_TRACE_H
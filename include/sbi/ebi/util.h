@@ -9,8 +9,7 @@
 #include <sbi/sbi_console.h>
 #include <sbi/sbi_trap.h>
 
-#define EBI_DEBUG
-
+/* Console debug output, build with `make EBI_DEBUG=y', see also trace.h */
 #ifdef EBI_DEBUG
 #define sbi_debug(fmt, ...) sbi_printf("[%s] " fmt, __func__, ##__VA_ARGS__)
 #else
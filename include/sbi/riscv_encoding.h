@@ -119,6 +119,9 @@
 #define SATP_MODE_SV57			_UL(10)
 #define SATP_MODE_SV64			_UL(11)
 
+#define ENVCFG_STCE			(_ULL(1) << 63)
+#define ENVCFGH_STCE			(_UL(1) << 31)
+
 #define HGATP_MODE_OFF			_UL(0)
 #define HGATP_MODE_SV32X4		_UL(1)
 #define HGATP_MODE_SV39X4		_UL(8)
@@ -276,6 +279,10 @@
 /* Supervisor Protection and Translation */
 #define CSR_SATP			0x180
 
+/* Supervisor Timer Compare (Sstc) */
+#define CSR_STIMECMP			0x14d
+#define CSR_STIMECMPH			0x15d
+
 /* ===== Hypervisor-level CSRs ===== */
 
 /* Hypervisor Trap Setup (H-extension) */
@@ -329,6 +336,10 @@
 #define CSR_MCOUNTEREN			0x306
 #define CSR_MSTATUSH			0x310
 
+/* Machine Configuration */
+#define CSR_MENVCFG			0x30a
+#define CSR_MENVCFGH			0x31a
+
 /* Machine Trap Handling */
 #define CSR_MSCRATCH			0x340
 #define CSR_MEPC			0x341
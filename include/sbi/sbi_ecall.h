@@ -20,6 +20,23 @@
 struct sbi_trap_regs;
 struct sbi_trap_info;
 
+/** Ecall types with round-trip cycle counts */
+enum sbi_ecall_stat_type {
+	/** Fast path, see TRAP_FAST_ECALL in fw_base.S */
+	SBI_ECALL_STAT_TIME = 0,
+	SBI_ECALL_STAT_IPI,
+	SBI_ECALL_STAT_RFENCE,
+	/** Any other ecall, through sbi_trap_handler() */
+	SBI_ECALL_STAT_SLOW,
+	SBI_ECALL_STAT_MAX,
+};
+
+/** Per-HART ecall counts and cycles spent in them */
+struct sbi_ecall_stats {
+	unsigned long count[SBI_ECALL_STAT_MAX];
+	unsigned long cycles[SBI_ECALL_STAT_MAX];
+};
+
 struct sbi_ecall_extension {
 	struct sbi_dlist head;
 	unsigned long extid_start;
@@ -58,6 +75,12 @@ void sbi_ecall_unregister_extension(struct sbi_ecall_extension *ext);
 
 int sbi_ecall_handler(struct sbi_trap_regs *regs);
 
+void sbi_ecall_fast_handler(struct sbi_trap_regs *regs, unsigned long start);
+
+struct sbi_ecall_stats *sbi_ecall_stats_get(u32 hartid);
+
+void sbi_ecall_stats_dump(void);
+
 int sbi_ecall_init(void);
 
 #endif
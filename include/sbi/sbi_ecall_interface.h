@@ -112,10 +112,14 @@
 #define SBI_EXT_EBI_CREATE  399
 #define SBI_EXT_EBI_ENTER   400
 #define SBI_EXT_EBI_EXIT    401
+#define SBI_EXT_EBI_LAUNCH  402
 #define SBI_EXT_EBI_SUSPEND 403
 #define SBI_EXT_EBI_RESUME  404
 #define SBI_EXT_EBI_MEM_ALLOC 405
 #define SBI_EXT_EBI_MAP_REGISTER 406
+#define SBI_EXT_EBI_TIMEBASE 407
+#define SBI_EXT_EBI_SHARE 408
+#define SBI_EXT_EBI_SHARE_INFO 409
 
 #define SBI_EXT_EBI_PUTS    410
 #define SBI_EXT_EBI_GETS    411
@@ -127,6 +131,23 @@
 #define SBI_EXT_EBI_FLUSH_DCACHE 430
 #define SBI_EXT_EBI_DISCARD_DCACHE 431
 
+#define SBI_EXT_EBI_SL_SETUP 440
+#define SBI_EXT_EBI_SL_TEARDOWN 441
+#define SBI_EXT_EBI_OCALL_SETUP 442
+
+#define SBI_EXT_EBI_CHAN_OPEN 450
+#define SBI_EXT_EBI_CHAN_NOTIFY 451
+#define SBI_EXT_EBI_CHAN_WAIT 452
+#define SBI_EXT_EBI_CHAN_POLL 453
+
+#define SBI_EXT_EBI_THREAD_CREATE 460
+#define SBI_EXT_EBI_THREAD_EXIT 461
+
+#define SBI_EXT_EBI_SCHED_SET 470
+#define SBI_EXT_EBI_STOP 471
+
+#define SBI_EXT_EBI_STATS 480
+
 #define SBI_EXT_EBI_DEBUG 499
 
 /* clang-format on */
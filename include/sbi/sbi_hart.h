@@ -20,9 +20,11 @@ enum sbi_hart_features {
 	SBI_HART_HAS_MCOUNTEREN = (1 << 1),
 	/** HART has timer csr implementation in hardware */
 	SBI_HART_HAS_TIME = (1 << 2),
+	/** HART has S-mode timer compare (Sstc) */
+	SBI_HART_HAS_SSTC = (1 << 3),
 
 	/** Last index of Hart features*/
-	SBI_HART_HAS_LAST_FEATURE = SBI_HART_HAS_TIME,
+	SBI_HART_HAS_LAST_FEATURE = SBI_HART_HAS_SSTC,
 };
 
 struct sbi_scratch;
@@ -19,6 +19,7 @@
 /* clang-format on */
 
 struct sbi_scratch;
+struct sbi_trap_regs;
 
 /** IPI event operations or callbacks */
 struct sbi_ipi_event_ops {
@@ -35,9 +36,9 @@ struct sbi_ipi_event_ops {
 			u32 remote_hartid, void *data);
 
 	/**
-	 * Sync callback to wait for remote HART
-	 * Note: This is an optional callback and it is called just after
-	 * triggering IPI to remote HART.
+	 * Sync callback to wait for remote HARTs
+	 * Note: This is an optional callback and it is called once after
+	 * triggering IPIs to all remote HARTs of a request.
 	 */
 	void (* sync)(struct sbi_scratch *scratch);
 
@@ -47,6 +48,28 @@ struct sbi_ipi_event_ops {
 	 * remote HART after IPI is triggered.
 	 */
 	void (* process)(struct sbi_scratch *scratch);
+
+	/**
+	 * Process callback with the interrupted context
+	 * Note: This is an optional callback. When present, it is called
+	 * instead of process() for IPIs taken as a trap, and may change
+	 * the context the remote HART returns to.
+	 */
+	void (* process_trap)(struct sbi_scratch *scratch,
+			      struct sbi_trap_regs *regs);
+};
+
+/**
+ * Device raising S-mode software interrupts without M-mode, such as an
+ * ACLINT SSWI. The OS finds the same device in the FDT and may use it
+ * on its own; the SBI IPI extension goes through it as well.
+ */
+struct sbi_ipi_smode_device {
+	/** Name of the device */
+	char name[32];
+
+	/** Set SSIP of a HART, non-zero if the device does not reach it */
+	int (* ipi_send)(u32 target_hart);
 };
 
 int sbi_ipi_send_many(ulong hmask, ulong hbase, u32 event, void *data);
@@ -59,9 +82,13 @@ int sbi_ipi_send_smode(ulong hmask, ulong hbase);
 
 void sbi_ipi_clear_smode(void);
 
+const struct sbi_ipi_smode_device *sbi_ipi_get_smode_device(void);
+
+void sbi_ipi_set_smode_device(const struct sbi_ipi_smode_device *dev);
+
 int sbi_ipi_send_halt(ulong hmask, ulong hbase);
 
-void sbi_ipi_process(void);
+void sbi_ipi_process(struct sbi_trap_regs *regs);
 
 int sbi_ipi_init(struct sbi_scratch *scratch, bool cold_boot);
 
@@ -13,6 +13,30 @@
 #include <sbi/sbi_types.h>
 
 struct sbi_scratch;
+struct sbi_trap_regs;
+
+/** Maximum number of timer events queued on a HART, S-mode's included */
+#define SBI_TIMER_EVENT_MAX 16
+
+/** Firmware timer event, queued on the HART that added it */
+struct sbi_timer_event {
+	/** Absolute deadline in timer ticks */
+	u64 deadline;
+	/** Called from the timer trap once the deadline passed */
+	void (*fn)(struct sbi_timer_event *ev, struct sbi_trap_regs *regs);
+	/** Owner data */
+	void *priv;
+	/** Position in the HART's queue, -1 if not queued */
+	int index;
+};
+
+#define SBI_TIMER_EVENT_INIT(__ev, __fn, __priv) \
+	do {                                     \
+		(__ev)->deadline = -1ULL;        \
+		(__ev)->fn = (__fn);             \
+		(__ev)->priv = (__priv);         \
+		(__ev)->index = -1;              \
+	} while (0)
 
 /** Get timer value for current HART */
 u64 sbi_timer_value(void);
@@ -29,11 +53,29 @@ void sbi_timer_set_delta(ulong delta);
 /** Set upper 32-bits of timer delta value for current HART */
 void sbi_timer_set_delta_upper(ulong delta_upper);
 
+/** Get timer frequency (ticks per second), 0 if unknown */
+unsigned long sbi_timer_get_timebase_freq(void);
+
+/** Set timer frequency (ticks per second) */
+void sbi_timer_set_timebase_freq(unsigned long freq);
+
 /** Start timer event for current HART */
 void sbi_timer_event_start(u64 next_event);
 
+/** S-mode timer compare of current HART with Sstc, -1ULL without */
+u64 sbi_timer_smode_get(void);
+
+/** Set S-mode timer compare of current HART, only with Sstc */
+void sbi_timer_smode_set(u64 deadline);
+
+/** Queue (or move) a firmware timer event on current HART */
+int sbi_timer_add(struct sbi_timer_event *ev, u64 deadline);
+
+/** Remove a firmware timer event from current HART, if queued there */
+void sbi_timer_del(struct sbi_timer_event *ev);
+
 /** Process timer event for current HART */
-void sbi_timer_process(void);
+void sbi_timer_process(struct sbi_trap_regs *regs);
 
 /* Initialize timer */
 int sbi_timer_init(struct sbi_scratch *scratch, bool cold_boot);
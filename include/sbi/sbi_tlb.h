@@ -20,7 +20,8 @@
 
 /* clang-format on */
 
-#define SBI_TLB_FIFO_NUM_ENTRIES		8
+/* Per-HART request ring, a power of two */
+#define SBI_TLB_RING_NUM_ENTRIES		8
 
 struct sbi_scratch;
 
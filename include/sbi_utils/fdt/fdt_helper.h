@@ -50,10 +50,15 @@ int fdt_find_match(void *fdt, int startoff,
 int fdt_get_node_addr_size(void *fdt, int node, unsigned long *addr,
 			   unsigned long *size);
 
+int fdt_get_node_addr_size_by_index(void *fdt, int node, int index,
+				    unsigned long *addr, unsigned long *size);
+
 int fdt_parse_hart_id(void *fdt, int cpu_offset, u32 *hartid);
 
 int fdt_parse_max_hart_id(void *fdt, u32 *max_hartid);
 
+int fdt_parse_timebase_frequency(void *fdt, unsigned long *freq);
+
 int fdt_parse_shakti_uart_node(void *fdt, int nodeoffset,
 			       struct platform_uart_data *uart);
 
@@ -77,6 +82,11 @@ struct clint_data;
 int fdt_parse_clint_node(void *fdt, int nodeoffset, bool for_timer,
 			 struct clint_data *clint);
 
+int fdt_parse_aclint_node(void *fdt, int nodeoffset, u32 match_hwirq,
+			  unsigned long *out_addr1, unsigned long *out_size1,
+			  unsigned long *out_addr2, unsigned long *out_size2,
+			  u32 *out_first_hartid, u32 *out_hart_count);
+
 int fdt_parse_compat_addr(void *fdt, unsigned long *addr,
 			  const char *compatible);
 
@@ -27,6 +27,8 @@ void fdt_ipi_clear(u32 target_hart);
 
 void fdt_ipi_exit(void);
 
+int fdt_ipi_sswi_cold_init(void *fdt);
+
 int fdt_ipi_init(bool cold_boot);
 
 #endif
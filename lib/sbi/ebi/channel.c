@@ -0,0 +1,161 @@
+#include <sbi/ebi/channel.h>
+#include <sbi/ebi/memory.h>
+#include <sbi/ebi/memutil.h>
+#include <sbi/ebi/pmp.h>
+#include <sbi/sbi_ipi.h>
+
+static channel_t channels[CHAN_MAX];
+static spinlock_t chan_lock;
+
+void init_channels(void)
+{
+	int i;
+
+	for (i = 0; i < CHAN_MAX; i++)
+		channels[i].state = CHAN_FREE;
+	SPIN_LOCK_INIT(&chan_lock);
+}
+
+// Side of `eid' in `chan', -1 if it is not an endpoint
+static int channel_side(channel_t *chan, int eid)
+{
+	if (chan->state == CHAN_FREE)
+		return -1;
+	if (chan->eid[0] == eid)
+		return 0;
+	if (chan->eid[1] == eid)
+		return 1;
+	return -1;
+}
+
+/*
+ * Join the channel `peer' opened towards the caller, or open a new one and
+ * wait for `peer' to join. Returns the channel ID in a1 and the PA of its
+ * section in a2, the caller maps the section itself.
+ */
+uintptr_t channel_open(enclave_context_t *ectx, uintptr_t peer,
+		       struct sbi_trap_regs *regs)
+{
+	channel_t *chan = NULL;
+	section_t *sec;
+	int i;
+
+	if (!ectx->id || peer < 1 || peer > NUM_ENCLAVE || peer == ectx->id ||
+	    !check_alive(peer)) {
+		sbi_error("Invalid channel peer %ld\n", peer);
+		return EBI_ERROR;
+	}
+
+	spin_lock(&chan_lock);
+	for (i = 0; i < CHAN_MAX; i++) {
+		if (channels[i].state == CHAN_PENDING &&
+		    channels[i].eid[0] == (int)peer &&
+		    channels[i].eid[1] == (int)ectx->id) {
+			chan	    = &channels[i];
+			chan->state = CHAN_OPEN;
+			goto done;
+		}
+	}
+	for (i = 0; i < CHAN_MAX; i++) {
+		if (channels[i].state == CHAN_FREE) {
+			chan = &channels[i];
+			break;
+		}
+	}
+	if (!chan) {
+		spin_unlock(&chan_lock);
+		sbi_error("Out of channels\n");
+		return EBI_ERROR;
+	}
+
+	sec = claim_available_section(CHAN_OWNER, 0);
+	if (!sec) {
+		spin_unlock(&chan_lock);
+		return EBI_ERROR;
+	}
+	set_section_zero(sec->sfn);
+	chan->sfn    = sec->sfn;
+	chan->eid[0] = ectx->id;
+	chan->eid[1] = peer;
+	chan->state  = CHAN_PENDING;
+
+done:
+	spin_unlock(&chan_lock);
+	pmp_allow_region(chan->sfn << SECTION_SHIFT, SECTION_SIZE);
+	sbi_debug("enclave %ld: channel %d to %ld at 0x%lx\n", ectx->id, i,
+		  peer, chan->sfn << SECTION_SHIFT);
+	regs->a1 = i;
+	regs->a2 = chan->sfn << SECTION_SHIFT;
+	return EBI_OK;
+}
+
+// Ring the doorbell of `eid', and interrupt it if it is on a hart right now
+static void channel_ring(int eid, uintptr_t id)
+{
+	enclave_context_t *peer = eid_to_context(eid);
+	int hart;
+
+	__atomic_fetch_or(&peer->chan_bell, 1UL << id, __ATOMIC_RELEASE);
+	for (hart = 0; hart < NUM_CORES; hart++) {
+		if (enclave_on_core[hart] == eid)
+			sbi_ipi_send_smode(1UL, hart);
+	}
+}
+
+uintptr_t channel_notify(enclave_context_t *ectx, uintptr_t id)
+{
+	channel_t *chan;
+	int side, peer;
+
+	if (id >= CHAN_MAX)
+		return EBI_ERROR;
+	chan = &channels[id];
+	side = channel_side(chan, ectx->id);
+	if (side < 0 || chan->state != CHAN_OPEN)
+		return EBI_ERROR;
+	peer = chan->eid[!side];
+	if (peer < 0)
+		return EBI_ERROR;
+
+	channel_ring(peer, id);
+	return EBI_OK;
+}
+
+uintptr_t channel_take_bells(enclave_context_t *ectx)
+{
+	return __atomic_exchange_n(&ectx->chan_bell, 0, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * Leave every channel of an exiting enclave. The section is freed with the
+ * last side; until then the peer keeps it and finds its doorbell rung.
+ */
+void channel_close_all(enclave_context_t *ectx)
+{
+	channel_t *chan;
+	int i, side;
+
+	spin_lock(&chan_lock);
+	for (i = 0; i < CHAN_MAX; i++) {
+		chan = &channels[i];
+		side = channel_side(chan, ectx->id);
+		if (side < 0)
+			continue;
+		chan->eid[side] = -1;
+		if (chan->state == CHAN_OPEN && chan->eid[!side] >= 0) {
+			channel_ring(chan->eid[!side], i);
+			continue;
+		}
+		// Named but never joined: the opener still maps the section
+		if (chan->state == CHAN_PENDING && side == 1) {
+			chan->state = CHAN_OPEN;
+			continue;
+		}
+		spin_lock(&memory_pool_lock);
+		free_section(chan->sfn);
+		spin_unlock(&memory_pool_lock);
+		chan->state = CHAN_FREE;
+	}
+	ectx->chan_bell = 0;
+	spin_unlock(&chan_lock);
+}
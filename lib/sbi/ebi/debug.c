@@ -4,8 +4,10 @@
 #include <sbi/ebi/memutil.h>
 #include <sbi/riscv_asm.h>
 #include <sbi/riscv_encoding.h>
+#include <sbi/sbi_ecall.h>
 #include <sbi/sbi_string.h>
 #include <sbi/ebi/monitor.h>
+#include <sbi/ebi/trace.h>
 
 void enclave_debug(struct sbi_trap_regs *regs)
 {
@@ -45,6 +47,20 @@ void enclave_debug(struct sbi_trap_regs *regs)
 		debug_memdump(addr, len);
 		break;
 
+	case 7:
+		sbi_ecall_stats_dump();
+		break;
+
+	case 8:
+		// Trace classes to record from now on, returns the old ones
+		regs->a0 = trace_set_mask(regs->a1);
+		break;
+
+	case 9:
+		// Decode the trace of hart a1, -1 for all of them
+		trace_dump(regs->a1);
+		break;
+
 	default:
 		break;
 	}
@@ -6,10 +6,19 @@
 #include <sbi/riscv_locks.h>
 
 extern char _console_start, _console_end;
-drv_addr_t __drv_addr_list[MAX_DRV] = { { .drv_start =
-						  (uintptr_t)&_console_start,
-					  .drv_end  = (uintptr_t)&_console_end,
-					  .using_by = -1 } };
+extern char _virtio_blk_start, _virtio_blk_end;
+extern char _virtio_console_start, _virtio_console_end;
+drv_addr_t __drv_addr_list[MAX_DRV] = {
+	[DRV_ID_CONSOLE]    = { .drv_start = (uintptr_t)&_console_start,
+				.drv_end   = (uintptr_t)&_console_end,
+				.using_by  = -1 },
+	[DRV_ID_VIRTIO_BLK] = { .drv_start = (uintptr_t)&_virtio_blk_start,
+				.drv_end   = (uintptr_t)&_virtio_blk_end,
+				.using_by  = -1 },
+	[DRV_ID_VIRTIO_CONSOLE] = { .drv_start = (uintptr_t)&_virtio_console_start,
+				    .drv_end   = (uintptr_t)&_virtio_console_end,
+				    .using_by  = -1 },
+};
 drv_addr_t *drv_addr_list = __drv_addr_list; // Tricky! Do not change this!
 spinlock_t drv_lock[MAX_DRV];
 
@@ -23,31 +32,31 @@ void drv_release(uintptr_t drv_to_release)
 	spin_unlock(&drv_lock[drv_to_release]);
 }
 
+/*
+ * Drivers keep their global index in the enclave's copy of the list, so the
+ * base module can look a driver up by ID whatever `drv_mask' selected.
+ * Entries of drivers not copied stay zero. Each driver starts on a page
+ * boundary to keep the alignment its binary was linked with.
+ */
 uintptr_t copy_drv_with_list(uintptr_t *dst_addr, uintptr_t drv_mask)
 {
-	// Default initialization implicitly calls `memset'
 	drv_addr_t local_addr_list[MAX_DRV];
-	int cnt = 0;
 	int i;
 	uintptr_t drv_start, drv_size;
+
+	sbi_memset(local_addr_list, 0, sizeof(local_addr_list));
 	for (i = 0; i < MAX_DRV; ++i) {
-		if ((drv_mask & (1 << i)) && drv_addr_list[i].drv_start) {
+		if ((drv_mask & (1UL << i)) && drv_addr_list[i].drv_start) {
 			drv_start = drv_addr_list[i].drv_start;
 			drv_size  = drv_addr_list[i].drv_end -
 				   drv_addr_list[i].drv_start;
-			local_addr_list[cnt].drv_start = *dst_addr;
-			local_addr_list[cnt].drv_end   = *dst_addr + drv_size;
-			++cnt;
+			local_addr_list[i].drv_start = *dst_addr;
+			local_addr_list[i].drv_end   = *dst_addr + drv_size;
 			sbi_memcpy((void *)(*dst_addr), (void *)drv_start,
 				   drv_size);
-			*dst_addr += drv_size;
+			*dst_addr += PAGE_UP(drv_size);
 		}
 	}
-	if (i < MAX_DRV) {
-		local_addr_list[i].drv_start = 0; // Mark the end of the list
-		local_addr_list[i].drv_end   = 0;
-		local_addr_list[i].using_by  = 0;
-	}
 	sbi_memcpy((void *)*dst_addr, (void *)local_addr_list,
 		   sizeof(local_addr_list));
 	return sizeof(local_addr_list);
@@ -1,16 +1,43 @@
 #include <sbi/ebi/enclave.h>
+#include <sbi/ebi/channel.h>
 #include <sbi/ebi/memory.h>
+#include <sbi/ebi/memutil.h>
 #include <sbi/ebi/drv.h>
+#include <sbi/ebi/ipi.h>
 #include <sbi/ebi/pmp.h>
+#include <sbi/ebi/sched.h>
+#include <sbi/ebi/stats.h>
+#include <sbi/ebi/trace.h>
 #include <sbi/riscv_asm.h>
 #include <sbi/riscv_encoding.h>
 #include <sbi/sbi_string.h>
 #include <sbi/riscv_io.h>
+#include <sbi/sbi_domain.h>
+#include <sbi/sbi_hart.h>
+#include <sbi/sbi_hsm.h>
+#include <sbi/sbi_ipi.h>
+#include <sbi/sbi_timer.h>
 
 enclave_context_t enclaves[NUM_ENCLAVE + 1];
 int enclave_on_core[NUM_CORES];
+int thread_on_core[NUM_CORES];
 spinlock_t enclave_lock, core_lock;
 
+/* Enclave queued for, or running on, a hart started by `launch_enclave' */
+typedef struct {
+	uintptr_t eid; // 0 if the hart is not ours
+	uintptr_t tid; // secondary thread to start, 0 for the main one
+	uintptr_t resume; // resume a suspended enclave instead of entering
+	uintptr_t argc, argv;
+	uintptr_t done_pa; // `launch_done_t' in host memory
+	uintptr_t saddr; // start address given to HSM, in the enclave memory
+	uint32_t host_hart; // launching hart, interrupted on completion
+} launch_t;
+
+static launch_t launches[NUM_CORES];
+
+static void __noreturn launch_complete(uintptr_t state, uintptr_t ret);
+
 extern char _base_start, _base_end;
 
 #pragma GCC diagnostic ignored "-Wunused-function"
@@ -74,6 +101,7 @@ static void init_enclave_context(enclave_context_t *ectx)
 	ectx->ns_sie	       = 0;
 	ectx->ns_stvec	       = 0;
 	ectx->ns_sepc	       = 0;
+	ectx->ns_stimecmp      = -1ULL;
 	ectx->pt_root_addr     = 0;
 	ectx->inverse_map_addr = 0;
 	ectx->offset_addr      = 0;
@@ -91,6 +119,8 @@ static void save_enclave_context(enclave_context_t *ectx, uintptr_t mepc,
 	ectx->ns_sstatus  = csr_read(CSR_SSTATUS);
 	ectx->ns_sscratch = csr_read(CSR_SSCRATCH);
 	ectx->ns_sepc	  = csr_read(CSR_SEPC);
+	// With Sstc the host's timer must not fire into the enclave
+	ectx->ns_stimecmp = sbi_timer_smode_get();
 }
 
 static void restore_enclave_context(enclave_context_t *ectx,
@@ -105,6 +135,7 @@ static void restore_enclave_context(enclave_context_t *ectx,
 	csr_write(CSR_SSTATUS, ectx->ns_sstatus);
 	csr_write(CSR_SSCRATCH, ectx->ns_sscratch);
 	csr_write(CSR_SEPC, ectx->ns_sepc);
+	sbi_timer_smode_set(ectx->ns_stimecmp);
 
 	regs->mepc    = ectx->ns_mepc - 4;
 	regs->mstatus = ectx->ns_mstatus;
@@ -135,6 +166,10 @@ static void enclave_mem_free(enclave_context_t *ectx)
 	}
 
 	sbi_debug("Freeing enclave %d\n", eid);
+	switchless_teardown(ectx);
+	ocall_teardown(ectx);
+	channel_close_all(ectx);
+	unshare_sections_of_enclave(ectx);
 	free_section_for_enclave(eid);
 	sbi_debug("Freed enclave %d\n", eid);
 }
@@ -142,6 +177,10 @@ static void enclave_mem_free(enclave_context_t *ectx)
 void init_enclaves(void)
 {
 	init_memory_pool();
+	init_channels();
+	init_sched();
+	if (init_ebi_ipi())
+		sbi_error("No IPI event left for enclave control\n");
 	enclaves[0].status = ENC_RUN;
 	for (size_t i = 1; i <= NUM_ENCLAVE; ++i)
 		enclaves[i].status = ENC_FREE;
@@ -212,6 +251,15 @@ uintptr_t create_enclave(struct sbi_trap_regs *regs, uintptr_t mepc)
 	ectx->pt_root_addr     = 0;
 	ectx->offset_addr      = 0;
 	ectx->inverse_map_addr = 0;
+	ectx->shm_cnt	       = 0;
+	ectx->sl_ring_pa       = 0;
+	ectx->oc_area_pa       = 0;
+	ectx->chan_bell	       = 0;
+	ectx->n_threads	       = 0;
+	stats_enclave_reset(enclave_id);
+	for (i = 0; i < ENC_THREAD_MAX; i++)
+		ectx->threads[i].status = ENC_FREE;
+	sched_init_enclave(ectx);
 	sbi_debug("Created enclave with ID=%lx\n", ectx->id);
 
 	// Allocate initial memory
@@ -250,6 +298,8 @@ uintptr_t create_enclave(struct sbi_trap_regs *regs, uintptr_t mepc)
 	ectx->drv_list		  = enclave_base_addr;
 	ectx->user_param	  = enclave_base_addr + drv_size;
 
+	ebi_trace(TRACE_ENCLAVE, TRACE_EV_CREATE, enclave_id, ectx->pa,
+		  payload_size, 0);
 	regs->a0 = enclave_id;
 	return enclave_id;
 }
@@ -267,6 +317,7 @@ uintptr_t enter_enclave(struct sbi_trap_regs *regs, uintptr_t mepc)
 		return EBI_ERROR;
 	}
 	sbi_debug("Entering enclave #0x%lx\n", id);
+	ebi_trace(TRACE_ENCLAVE, TRACE_EV_ENTER, id, regs->a1, 0, 0);
 
 #ifdef EBI_DEBUG
 	uintptr_t mtvec = csr_read(CSR_MTVEC);
@@ -322,9 +373,39 @@ uintptr_t enter_enclave(struct sbi_trap_regs *regs, uintptr_t mepc)
 	host->status = ENC_IDLE;
 	ectx->status = ENC_RUN;
 	spin_unlock(&enclave_lock);
+	sched_arm(ectx);
+	ebi_ipi_wait_held(id);
 	return id;
 }
 
+/*
+ * End the secondary threads of an exiting enclave: the ones not started yet
+ * are cancelled, the running ones killed on their harts. Returns EBI_ERROR
+ * if some of them are still there, the main thread may try again.
+ */
+static uintptr_t enclave_stop_threads(enclave_context_t *ectx)
+{
+	int i;
+
+	if (!__atomic_load_n(&ectx->n_threads, __ATOMIC_ACQUIRE))
+		return EBI_OK;
+
+	// `launch_run' only starts a thread still in ENC_LOAD
+	spin_lock(&enclave_lock);
+	for (i = 0; i < ENC_THREAD_MAX; i++) {
+		if (ectx->threads[i].status != ENC_LOAD)
+			continue;
+		ectx->threads[i].status = ENC_FREE;
+		__atomic_fetch_sub(&ectx->n_threads, 1, __ATOMIC_ACQ_REL);
+	}
+	spin_unlock(&enclave_lock);
+
+	if (__atomic_load_n(&ectx->n_threads, __ATOMIC_ACQUIRE))
+		ebi_ipi_kill_threads(ectx->id);
+	return __atomic_load_n(&ectx->n_threads, __ATOMIC_ACQUIRE) ? EBI_ERROR :
+								      EBI_OK;
+}
+
 uintptr_t exit_enclave(struct sbi_trap_regs *regs)
 {
 	uintptr_t id		= regs->a0;
@@ -332,6 +413,21 @@ uintptr_t exit_enclave(struct sbi_trap_regs *regs)
 	uint32_t hart_id	= current_hartid();
 	enclave_context_t *ectx = &enclaves[id];
 	enclave_context_t *host = &enclaves[0];
+
+	// Only the main thread ends the enclave, once it is the last one
+	if ((hart_id < NUM_CORES && thread_on_core[hart_id]) ||
+	    enclave_stop_threads(ectx))
+		return EBI_ERROR;
+
+	// Launched on its own hart: no host context here to go back to
+	if (hart_id < NUM_CORES && launches[hart_id].eid == id) {
+		enclave_mem_free(ectx);
+		spin_lock(&enclave_lock);
+		ectx->status = ENC_FREE;
+		spin_unlock(&enclave_lock);
+		launch_complete(LAUNCH_EXITED, ret_val);
+	}
+
 	if (ectx->status != ENC_RUN || host->status != ENC_IDLE) {
 		sbi_error("Invalid runtime state! eid = %lx\n", id);
 		sbi_error("ectx->status = %d, host->status = %d\n",
@@ -339,6 +435,7 @@ uintptr_t exit_enclave(struct sbi_trap_regs *regs)
 		return EBI_ERROR;
 	}
 	sbi_debug("Exiting encalve #0x%lx\n", id);
+	ebi_trace(TRACE_ENCLAVE, TRACE_EV_EXIT, id, ret_val, 0, 0);
 
 #ifdef EBI_DEBUG
 	uintptr_t mtvec = csr_read(CSR_MTVEC);
@@ -351,6 +448,7 @@ uintptr_t exit_enclave(struct sbi_trap_regs *regs)
 	spin_lock(&core_lock);
 	enclave_on_core[hart_id] = 0;
 	spin_unlock(&core_lock);
+	sched_disarm();
 	pmp_switch(NULL);
 	restore_umode_context(host, regs);
 	restore_enclave_context(host, regs);
@@ -391,6 +489,7 @@ uintptr_t suspend_enclave(uintptr_t eid, struct sbi_trap_regs *regs,
 		sbi_error("Suspend error\n");
 		return EBI_ERROR;
 	}
+	ebi_trace(TRACE_ENCLAVE, TRACE_EV_SUSPEND, eid, mepc, 0, 0);
 
 	spin_lock(&core_lock);
 	enclave_on_core[hartid] = 0;
@@ -418,6 +517,7 @@ uintptr_t resume_enclave(uintptr_t eid, struct sbi_trap_regs *regs)
 		// while(1);
 		return EBI_ERROR;
 	}
+	ebi_trace(TRACE_ENCLAVE, TRACE_EV_RESUME, eid, 0, 0, 0);
 
 	spin_lock(&core_lock);
 	enclave_on_core[hartid] = eid;
@@ -427,11 +527,431 @@ uintptr_t resume_enclave(uintptr_t eid, struct sbi_trap_regs *regs)
 	restore_enclave_context(into, regs);
 	restore_umode_context(into, regs);
 
-	into->status = ENC_RUN;
+	into->status	      = ENC_RUN;
+	into->sched.preempted = 0;
+	sched_arm(into);
+	if (eid)
+		ebi_ipi_wait_held(eid);
 
 	return eid;
 }
 
+// The completion record must be plain host memory the host may write
+static int launch_done_valid(uintptr_t pa)
+{
+	section_t *sec;
+
+	if (!pa || (pa & (sizeof(launch_done_t) - 1)) ||
+	    !sbi_domain_check_addr(sbi_domain_thishart_ptr(), pa, PRV_S,
+				   SBI_DOMAIN_READ | SBI_DOMAIN_WRITE))
+		return 0;
+	if (pa >= MEMORY_POOL_START && pa < MEMORY_POOL_END) {
+		sec = sfn_to_section(pa >> SECTION_SHIFT);
+		return sec->owner == 0 && sec->share < 0;
+	}
+	return 1;
+}
+
+/*
+ * Queue `req' on a hart that is stopped in HSM and start that hart. It is
+ * started through `sbi_hsm_hart_start' with the caller's domain, so the
+ * hart and start address get the checks a host start gets. `launch_run'
+ * takes over on the way out of warm boot only when the hart's launch slot
+ * is taken and `next_addr' is the start address recorded in it. The slot
+ * is only taken here, while the hart is stopped, and is freed before the
+ * hart stops again, so a later host start of that hart finds it empty.
+ * A host start that races with ours, at the enclave PA itself, would be
+ * taken over too; ruling that out needs PMP to keep the host from using
+ * enclave memory, which is still to do.
+ * Returns the hart ID, -1 if every hart is busy.
+ */
+static int launch_on_stopped_hart(const launch_t *req)
+{
+	struct sbi_scratch *scratch = sbi_scratch_thishart_ptr();
+	const struct sbi_domain *dom = sbi_domain_thishart_ptr();
+	uint32_t self = current_hartid(), hart;
+	uintptr_t free = 0;
+	launch_t *l;
+
+	for (hart = 0; hart < NUM_CORES; hart++) {
+		l = &launches[hart];
+		if (hart == self ||
+		    sbi_hsm_hart_get_state(dom, hart) != SBI_HART_STOPPED ||
+		    !__atomic_compare_exchange_n(&l->eid, &free, req->eid, 0,
+						 __ATOMIC_ACQUIRE,
+						 __ATOMIC_RELAXED)) {
+			free = 0;
+			continue;
+		}
+		l->tid	     = req->tid;
+		l->resume    = req->resume;
+		l->argc	     = req->argc;
+		l->argv	     = req->argv;
+		l->done_pa   = req->done_pa;
+		l->saddr     = enclaves[req->eid].pa;
+		l->host_hart = self;
+		// Fails if the host started the hart since we looked
+		if (!sbi_hsm_hart_start(scratch, dom, hart, l->saddr, PRV_S,
+					0))
+			return hart;
+		__atomic_store_n(&l->eid, 0, __ATOMIC_RELEASE);
+	}
+	return -1;
+}
+
+/*
+ * Start, or resume, enclave a0 on another hart and return right away with
+ * that hart's ID. a1 and a2 are the parameters `SBI_EXT_EBI_ENTER' takes,
+ * a3 the PA of a `launch_done_t'.
+ */
+uintptr_t launch_enclave(struct sbi_trap_regs *regs, uintptr_t mepc)
+{
+	uintptr_t id = regs->a0, done_pa = regs->a3;
+	enclave_context_t *ectx;
+	launch_done_t *done;
+	launch_t req;
+	int resume, hart;
+
+	if (id < 1 || id > NUM_ENCLAVE || !launch_done_valid(done_pa)) {
+		sbi_error("Invalid launch of enclave %lx\n", id);
+		return EBI_ERROR;
+	}
+	ectx = &enclaves[id];
+
+	// Take the enclave so the host cannot enter it meanwhile
+	spin_lock(&enclave_lock);
+	if (ectx->status != ENC_LOAD && ectx->status != ENC_IDLE) {
+		spin_unlock(&enclave_lock);
+		sbi_error("Enclave %lx is not loaded or suspended\n", id);
+		return EBI_ERROR;
+	}
+	resume	     = ectx->status == ENC_IDLE;
+	ectx->status = ENC_RUN;
+	spin_unlock(&enclave_lock);
+
+	if (!resume)
+		memcpy_from_user(ectx->user_param, regs->a2, regs->a1, mepc);
+	done	    = (launch_done_t *)done_pa;
+	done->ret   = 0;
+	done->state = LAUNCH_RUNNING;
+
+	req.eid	    = id;
+	req.tid	    = 0;
+	req.resume  = resume;
+	req.argc    = regs->a1;
+	req.argv    = regs->a2;
+	req.done_pa = done_pa;
+	hart	    = launch_on_stopped_hart(&req);
+	if (hart >= 0) {
+		sbi_debug("enclave %lx launched on hart %d\n", id, hart);
+		regs->a0 = hart;
+		return hart;
+	}
+
+	sbi_error("No stopped hart to launch enclave %lx on\n", id);
+	spin_lock(&enclave_lock);
+	ectx->status = resume ? ENC_IDLE : ENC_LOAD;
+	spin_unlock(&enclave_lock);
+	return EBI_ERROR;
+}
+
+// Start state of a secondary thread, it enters U-mode right at `entry'
+static void restore_thread_context(enclave_thread_t *t,
+				   struct sbi_trap_regs *regs)
+{
+	csr_write(CSR_SATP, t->ns_satp);
+	flush_tlb();
+
+	csr_write(CSR_MEDELEG, t->ns_medeleg);
+	csr_write(CSR_SIE, t->ns_sie);
+	csr_write(CSR_STVEC, t->ns_stvec);
+	csr_write(CSR_SSTATUS, t->ns_sstatus);
+	csr_write(CSR_SSCRATCH, t->desc.kstack);
+	csr_write(CSR_SEPC, 0);
+	sbi_timer_smode_set(-1ULL);
+
+	regs->mepc    = t->desc.entry;
+	regs->mstatus = t->ns_mstatus;
+	regs->sp      = t->desc.sp;
+	regs->gp      = t->desc.gp;
+	regs->tp      = t->desc.tp;
+	regs->a0      = t->desc.arg;
+}
+
+// Warm boot of a hart started by `launch_on_stopped_hart': enter the enclave
+void launch_run(struct sbi_scratch *scratch, u32 hartid)
+{
+	struct sbi_trap_regs regs;
+	enclave_context_t *ectx;
+	enclave_thread_t *t;
+	launch_t *l;
+
+	if (hartid >= NUM_CORES)
+		return;
+	l = &launches[hartid];
+	if (!__atomic_load_n(&l->eid, __ATOMIC_ACQUIRE) ||
+	    scratch->next_addr != l->saddr)
+		return;
+	ectx = &enclaves[l->eid];
+
+	sbi_memset(&regs, 0, sizeof(regs));
+	pmp_switch(ectx);
+	if (l->tid) {
+		t = &ectx->threads[l->tid - 1];
+		// Cancelled if the main thread exited meanwhile. Once on the
+		// core, an exiting main thread finds it and kills it instead
+		spin_lock(&enclave_lock);
+		if (t->status != ENC_LOAD) {
+			spin_unlock(&enclave_lock);
+			launch_complete(LAUNCH_EXITED, 0);
+		}
+		t->hart	  = hartid;
+		t->status = ENC_RUN;
+		spin_lock(&core_lock);
+		enclave_on_core[hartid] = ectx->id;
+		thread_on_core[hartid]	= l->tid;
+		spin_unlock(&core_lock);
+		spin_unlock(&enclave_lock);
+		restore_thread_context(t, &regs);
+	} else {
+		restore_enclave_context(ectx, &regs);
+		if (l->resume) {
+			restore_umode_context(ectx, &regs);
+		} else {
+			// Same arguments as `enter_enclave' passes to init_mem()
+			regs.a0 = ectx->id;
+			regs.a1 = ectx->id;
+			regs.a2 = ectx->pa;
+			regs.a3 = ectx->enclave_binary_size;
+			regs.a4 = ectx->drv_list;
+			regs.a5 = l->argc;
+			regs.a6 = l->argv;
+		}
+		// There is no ecall to step over, unlike in `sbi_ecall_handler'
+		regs.mepc += 4;
+
+		spin_lock(&core_lock);
+		enclave_on_core[hartid] = ectx->id;
+		thread_on_core[hartid]	= 0;
+		spin_unlock(&core_lock);
+	}
+	// Nothing to switch to on a borrowed hart
+	sched_disarm();
+	ebi_ipi_wait_held(ectx->id);
+
+	sbi_debug("hart %u: running enclave %lx, thread %lu\n", hartid,
+		  ectx->id, l->tid);
+	sbi_trap_exit(&regs);
+}
+
+/*
+ * Publish the outcome of a launch and stop this hart, it goes back to warm
+ * boot and waits there for the next start. Threads have no record.
+ */
+static void __noreturn launch_complete(uintptr_t state, uintptr_t ret)
+{
+	uint32_t hartid	    = current_hartid();
+	launch_t *l	    = &launches[hartid];
+	launch_done_t *done = (launch_done_t *)l->done_pa;
+	uint32_t host_hart  = l->host_hart;
+
+	spin_lock(&core_lock);
+	enclave_on_core[hartid] = 0;
+	thread_on_core[hartid]	= 0;
+	spin_unlock(&core_lock);
+	pmp_switch(NULL);
+	csr_write(CSR_SATP, 0);
+	flush_tlb();
+
+	if (done) {
+		done->ret = ret;
+		__atomic_store_n(&done->state, state, __ATOMIC_RELEASE);
+	}
+	__atomic_store_n(&l->eid, 0, __ATOMIC_RELEASE);
+	if (done)
+		sbi_ipi_send_smode(1UL, host_hart);
+
+	sbi_hsm_hart_stop(sbi_scratch_thishart_ptr(), TRUE);
+	sbi_hart_hang();
+}
+
+/*
+ * Leave a suspended enclave. On a launched hart there is no host context,
+ * the host learns about it from the completion record instead.
+ */
+void return_to_host(struct sbi_trap_regs *regs)
+{
+	uint32_t hartid = current_hartid();
+
+	if (hartid < NUM_CORES && launches[hartid].eid)
+		launch_complete(LAUNCH_SUSPENDED, 0);
+	resume_enclave(0, regs);
+}
+
+/*
+ * Start a secondary thread of the calling enclave on a stopped hart. a0 is
+ * the base module VA of a `thread_desc_t'. The thread inherits the S-mode
+ * state of its creator and starts in U-mode. Returns the thread ID.
+ */
+uintptr_t thread_create(enclave_context_t *ectx, struct sbi_trap_regs *regs,
+			uintptr_t mepc)
+{
+	thread_desc_t desc;
+	enclave_thread_t *t;
+	launch_t req;
+	uintptr_t mstatus;
+
+	memcpy_from_user((uintptr_t)&desc, regs->a0, sizeof(desc), mepc);
+	if (desc.tid < 1 || desc.tid > ENC_THREAD_MAX || !desc.kstack) {
+		sbi_error("Invalid thread %lu\n", desc.tid);
+		return EBI_ERROR;
+	}
+	t = &ectx->threads[desc.tid - 1];
+
+	spin_lock(&enclave_lock);
+	if (t->status != ENC_FREE) {
+		spin_unlock(&enclave_lock);
+		sbi_error("Thread %lu already exists\n", desc.tid);
+		return EBI_ERROR;
+	}
+	t->status = ENC_LOAD;
+	spin_unlock(&enclave_lock);
+
+	mstatus	      = regs->mstatus & ~(MSTATUS_MPP | MSTATUS_MPIE);
+	t->desc	      = desc;
+	t->ns_satp    = csr_read(CSR_SATP);
+	t->ns_mstatus = mstatus | (PRV_U << MSTATUS_MPP_SHIFT) | MSTATUS_MPIE;
+	t->ns_medeleg = csr_read(CSR_MEDELEG);
+	t->ns_sstatus = csr_read(CSR_SSTATUS);
+	t->ns_stvec   = csr_read(CSR_STVEC);
+	t->ns_sie     = csr_read(CSR_SIE);
+	__atomic_fetch_add(&ectx->n_threads, 1, __ATOMIC_ACQ_REL);
+
+	req.eid	    = ectx->id;
+	req.tid	    = desc.tid;
+	req.resume  = 0;
+	req.argc    = 0;
+	req.argv    = 0;
+	req.done_pa = 0;
+	if (launch_on_stopped_hart(&req) < 0) {
+		sbi_error("No stopped hart for thread %lu\n", desc.tid);
+		__atomic_fetch_sub(&ectx->n_threads, 1, __ATOMIC_ACQ_REL);
+		t->status = ENC_FREE;
+		return EBI_ERROR;
+	}
+	regs->a1 = desc.tid;
+	return EBI_OK;
+}
+
+// Thread `tid' is gone, the main thread waits for the count to drop to 0.
+// Called with `enclave_lock' held.
+static void enclave_drop_thread(enclave_context_t *ectx, int tid)
+{
+	ectx->threads[tid - 1].status = ENC_FREE;
+	__atomic_fetch_sub(&ectx->n_threads, 1, __ATOMIC_ACQ_REL);
+}
+
+// End the calling secondary thread and stop its hart
+uintptr_t thread_exit(enclave_context_t *ectx)
+{
+	uint32_t hartid = current_hartid();
+	int tid		= hartid < NUM_CORES ? thread_on_core[hartid] : 0;
+
+	if (!tid)
+		return EBI_ERROR;
+	spin_lock(&enclave_lock);
+	enclave_drop_thread(ectx, tid);
+	spin_unlock(&enclave_lock);
+	launch_complete(LAUNCH_EXITED, 0);
+}
+
+// The page table root moved: threads that did not start yet take the new one
+void enclave_rebase_threads(enclave_context_t *ectx, uintptr_t satp)
+{
+	int i;
+
+	for (i = 0; i < ENC_THREAD_MAX; i++) {
+		if (ectx->threads[i].status == ENC_LOAD)
+			ectx->threads[i].ns_satp = satp;
+	}
+}
+
+/*
+ * Stop enclave `eid' on this hart, from the EBI IPI that interrupted it
+ * (see <sbi/ebi/ipi.h>). Suspending only works for its main thread.
+ * Returns EBI_ERROR if the hart does not run it (any more).
+ */
+uintptr_t enclave_stop_local(uintptr_t eid, int kill,
+			     struct sbi_trap_regs *regs)
+{
+	uint32_t hartid		= current_hartid();
+	enclave_context_t *ectx = eid_to_context(eid);
+	enclave_context_t *host = &enclaves[0];
+	int launched;
+
+	if (hartid >= NUM_CORES || enclave_on_core[hartid] != (int)eid)
+		return EBI_ERROR;
+	launched = launches[hartid].eid == eid;
+
+	if (!kill) {
+		if (thread_on_core[hartid])
+			return EBI_ERROR;
+		// Unlike an ecall, there is no instruction to step over
+		suspend_enclave(eid, regs, regs->mepc - 4);
+		if (launched) {
+			ebi_ipi_ack(EBI_OK);
+			launch_complete(LAUNCH_SUSPENDED, 0);
+		}
+		resume_enclave(0, regs);
+		regs->mepc += 4;
+		return EBI_OK;
+	}
+
+	spin_lock(&enclave_lock);
+	if (!thread_on_core[hartid])
+		ectx->status = ENC_IDLE;
+	else
+		enclave_drop_thread(ectx, thread_on_core[hartid]);
+	spin_unlock(&enclave_lock);
+	if (launched) {
+		ebi_ipi_ack(EBI_OK);
+		launch_complete(LAUNCH_EXITED, EBI_ERROR);
+	}
+	// Back to the host as if its ENTER or RESUME had failed
+	spin_lock(&core_lock);
+	enclave_on_core[hartid] = 0;
+	spin_unlock(&core_lock);
+	sched_disarm();
+	pmp_switch(NULL);
+	restore_umode_context(host, regs);
+	restore_enclave_context(host, regs);
+	regs->mepc += 4;
+	regs->a0     = EBI_ERROR;
+	host->status = ENC_RUN;
+	return EBI_OK;
+}
+
+// Free a killed enclave, unless some hart still runs it
+uintptr_t enclave_reap(enclave_context_t *ectx)
+{
+	int i;
+
+	spin_lock(&enclave_lock);
+	if (ectx->status == ENC_RUN || ectx->status == ENC_FREE) {
+		spin_unlock(&enclave_lock);
+		return EBI_ERROR;
+	}
+	ectx->status = ENC_FREE;
+	spin_unlock(&enclave_lock);
+
+	enclave_mem_free(ectx);
+	for (i = 0; i < ENC_THREAD_MAX; i++)
+		ectx->threads[i].status = ENC_FREE;
+	ectx->n_threads = 0;
+	sbi_debug("enclave %lx killed\n", ectx->id);
+	return EBI_OK;
+}
+
 enclave_context_t *eid_to_context(uintptr_t eid)
 {
 	return &enclaves[eid];
@@ -0,0 +1,192 @@
+#include <sbi/ebi/ipi.h>
+#include <sbi/ebi/memory.h>
+#include <sbi/sbi_ipi.h>
+#include <sbi/sbi_scratch.h>
+
+/* The request in flight, owned by whoever holds `ebi_ipi_lock' */
+static struct {
+	uint32_t op;
+	uintptr_t eid;
+	uintptr_t satp; // new root for held harts, 0 to keep theirs
+	ulong targets; // harts yet to ack
+	ulong failed; // harts that acked with an error
+	uintptr_t held_eid; // enclave held until release, 0 if none
+	uint32_t n_held; // harts parked for `held_eid'
+} ebi_req;
+
+static spinlock_t ebi_ipi_lock;
+static u32 ebi_ipi_event = SBI_IPI_EVENT_MAX;
+
+void ebi_ipi_ack(uintptr_t result)
+{
+	ulong bit = 1UL << current_hartid();
+
+	if (result != EBI_OK)
+		__atomic_fetch_or(&ebi_req.failed, bit, __ATOMIC_RELAXED);
+	__atomic_fetch_and(&ebi_req.targets, ~bit, __ATOMIC_RELEASE);
+}
+
+/*
+ * Park until `held_eid' is released. The hart acks as soon as it is a
+ * target, it may have parked before the sender named it.
+ */
+static void ebi_ipi_park(uintptr_t eid)
+{
+	uint32_t hartid = current_hartid();
+	ulong bit	= 1UL << hartid;
+
+	__atomic_fetch_add(&ebi_req.n_held, 1, __ATOMIC_ACQ_REL);
+	while (__atomic_load_n(&ebi_req.held_eid, __ATOMIC_ACQUIRE) == eid) {
+		if (__atomic_load_n(&ebi_req.targets, __ATOMIC_ACQUIRE) & bit)
+			ebi_ipi_ack(EBI_OK);
+	}
+	if (ebi_req.satp && ebi_req.eid == eid &&
+	    enclave_on_core[hartid] == (int)eid)
+		csr_write(CSR_SATP, ebi_req.satp);
+	flush_tlb();
+	__atomic_fetch_sub(&ebi_req.n_held, 1, __ATOMIC_RELEASE);
+}
+
+// Handle the request if it is for this hart, `regs' is NULL if not trapped
+static void ebi_ipi_handle(struct sbi_trap_regs *regs)
+{
+	ulong bit = 1UL << current_hartid();
+
+	if (!(__atomic_load_n(&ebi_req.targets, __ATOMIC_ACQUIRE) & bit))
+		return;
+	if (ebi_req.op == EBI_IPI_HOLD) {
+		ebi_ipi_park(ebi_req.eid);
+		return;
+	}
+	if (!regs) {
+		ebi_ipi_ack(EBI_ERROR);
+		return;
+	}
+	ebi_ipi_ack(enclave_stop_local(ebi_req.eid,
+				       ebi_req.op == EBI_IPI_KILL, regs));
+}
+
+static void ebi_ipi_process(struct sbi_scratch *scratch)
+{
+	ebi_ipi_handle(NULL);
+}
+
+static void ebi_ipi_process_trap(struct sbi_scratch *scratch,
+				 struct sbi_trap_regs *regs)
+{
+	ebi_ipi_handle(regs);
+}
+
+static struct sbi_ipi_event_ops ebi_ipi_ops = {
+	.name	      = "IPI_EBI",
+	.process      = ebi_ipi_process,
+	.process_trap = ebi_ipi_process_trap,
+};
+
+int init_ebi_ipi(void)
+{
+	int ret = sbi_ipi_event_create(&ebi_ipi_ops);
+
+	if (ret < 0)
+		return ret;
+	ebi_ipi_event = ret;
+	SPIN_LOCK_INIT(&ebi_ipi_lock);
+	return 0;
+}
+
+// Take the request lock, answering requests of the current holder meanwhile
+static void ebi_ipi_lock_acquire(void)
+{
+	while (!spin_trylock(&ebi_ipi_lock))
+		ebi_ipi_handle(NULL);
+}
+
+/*
+ * Send `op' to every other hart running `eid' and wait for all the acks.
+ * Returns the mask of harts that failed.
+ */
+static ulong ebi_ipi_send_wait(uintptr_t eid, uint32_t op)
+{
+	uint32_t self = current_hartid(), hart;
+	ulong mask    = 0;
+
+	ebi_req.op     = op;
+	ebi_req.eid    = eid;
+	ebi_req.satp   = 0;
+	ebi_req.failed = 0;
+
+	// Against harts setting `enclave_on_core', see `ebi_ipi_wait_held'
+	spin_lock(&core_lock);
+	if (op == EBI_IPI_HOLD)
+		__atomic_store_n(&ebi_req.held_eid, eid, __ATOMIC_RELEASE);
+	for (hart = 0; hart < NUM_CORES; hart++) {
+		if (hart != self && enclave_on_core[hart] == (int)eid)
+			mask |= 1UL << hart;
+	}
+	spin_unlock(&core_lock);
+	if (!mask)
+		return 0;
+
+	__atomic_store_n(&ebi_req.targets, mask, __ATOMIC_RELEASE);
+	sbi_ipi_send_many(mask, 0, ebi_ipi_event, NULL);
+	while (__atomic_load_n(&ebi_req.targets, __ATOMIC_ACQUIRE))
+		;
+	return ebi_req.failed;
+}
+
+/*
+ * Suspend or kill enclave `eid' wherever it runs, on behalf of the host.
+ * A killed enclave is freed once no hart runs it any more.
+ */
+uintptr_t ebi_ipi_stop(uintptr_t eid, int kill)
+{
+	ulong failed;
+
+	if (eid < 1 || eid > NUM_ENCLAVE || !check_alive(eid))
+		return EBI_ERROR;
+
+	ebi_ipi_lock_acquire();
+	failed = ebi_ipi_send_wait(eid, kill ? EBI_IPI_KILL : EBI_IPI_SUSPEND);
+	spin_unlock(&ebi_ipi_lock);
+	if (failed) {
+		sbi_error("enclave %lx: harts 0x%lx did not stop\n", eid,
+			  failed);
+		return EBI_ERROR;
+	}
+	return kill ? enclave_reap(eid_to_context(eid)) : EBI_OK;
+}
+
+// Kill the secondary threads of `eid' on the other harts, for its exit
+uintptr_t ebi_ipi_kill_threads(uintptr_t eid)
+{
+	ulong failed;
+
+	ebi_ipi_lock_acquire();
+	failed = ebi_ipi_send_wait(eid, EBI_IPI_KILL);
+	spin_unlock(&ebi_ipi_lock);
+	return failed ? EBI_ERROR : EBI_OK;
+}
+
+// Park the other harts running `eid' until `ebi_ipi_release'
+void ebi_ipi_hold(uintptr_t eid)
+{
+	ebi_ipi_lock_acquire();
+	ebi_ipi_send_wait(eid, EBI_IPI_HOLD);
+}
+
+// Let the held harts go, switching them to page table root `satp' unless 0
+void ebi_ipi_release(uintptr_t satp)
+{
+	ebi_req.satp = satp;
+	__atomic_store_n(&ebi_req.held_eid, 0, __ATOMIC_RELEASE);
+	while (__atomic_load_n(&ebi_req.n_held, __ATOMIC_ACQUIRE))
+		;
+	spin_unlock(&ebi_ipi_lock);
+}
+
+// This hart just started running `eid': park if it is held
+void ebi_ipi_wait_held(uintptr_t eid)
+{
+	if (__atomic_load_n(&ebi_req.held_eid, __ATOMIC_ACQUIRE) == eid)
+		ebi_ipi_park(eid);
+}
@@ -1,5 +1,9 @@
 #include <sbi/ebi/memory.h>
 #include <sbi/ebi/memutil.h>
+#include <sbi/ebi/pmp.h>
+#include <sbi/ebi/ipi.h>
+#include <sbi/ebi/stats.h>
+#include <sbi/ebi/trace.h>
 #include <sbi/sbi_string.h>
 #include <sbi/riscv_asm.h>
 #include <sbi/riscv_encoding.h>
@@ -72,6 +76,7 @@ void init_memory_pool(void)
 		sec->sfn =
 			(MEMORY_POOL_START + i * SECTION_SIZE) >> SECTION_SHIFT;
 		sec->owner = -1;
+		sec->share = -1;
 	}
 	SPIN_LOCK_INIT(&memory_pool_lock);
 
@@ -100,6 +105,9 @@ uintptr_t alloc_section_for_enclave(enclave_context_t *ectx, uintptr_t va)
 		return alloc_section_for_host_os();
 	}
 
+	// The scans below do not hold `memory_pool_lock'. A section another
+	// hart claimed in the meantime sends us back here, see `found'.
+retry:
 	// 1. Look for available sections adjacent to allocated
 	//    sections owned by the enclave. If found, update PMP config
 	//    and return the pa of the section
@@ -130,7 +138,7 @@ uintptr_t alloc_section_for_enclave(enclave_context_t *ectx, uintptr_t va)
 	// 2. If no such section exists, then check whether the PMP resource
 	//    has run out. If not, allocate a new section for the enclave
 	if (get_avail_pmp_count(ectx) > 0) {
-		sec = find_available_section();
+		sec = claim_available_section(eid, va);
 		if (!sec) {
 			sbi_error("Out of memory!\n");
 			while (1)
@@ -144,7 +152,7 @@ uintptr_t alloc_section_for_enclave(enclave_context_t *ectx, uintptr_t va)
 			}
 		}
 		ret = sec->sfn;
-		goto found;
+		goto claimed;
 	}
 
 	// 3. If PMP resource has run out, find the smallest contiguous memory
@@ -162,18 +170,24 @@ try_find:
 	sbi_debug("avail at 0x%lx, len = 0x%lx\n", avail.sfn << SECTION_SHIFT,
 		  avail.length);
 	if (avail.length) {
-		for (int i = 0; i < smallest.length; i++) {
-			section_migration(smallest.sfn + i, avail.sfn + i);
+		int i;
+
+		for (i = 0; i < smallest.length; i++) {
+			if (!claim_section(avail.sfn + i, MIGRATE_OWNER, 0) ||
+			    !section_migration(smallest.sfn + i, avail.sfn + i))
+				break;
 		}
-		ret = smallest.sfn + smallest.length;
 		dump_section_ownership();
-		goto found;
+		if (i == smallest.length) {
+			ret = smallest.sfn + smallest.length;
+			goto found;
+		}
 	}
 	if (tried_flag) {
 		return 0;
 	}
 	// 4. If still not found, do page compaction, then repeat step 3.
-	sbi_printf("compact due to %ld\n", eid);
+	ebi_trace(TRACE_MEM, TRACE_EV_COMPACT, eid, 0, 0, 0);
 	page_compaction();
 	tried_flag = 1;
 	sbi_debug("After compaction\n");
@@ -181,8 +195,12 @@ try_find:
 	goto try_find;
 
 found:
+	if (!claim_section(ret, eid, va))
+		goto retry;
+claimed:
 	set_section_zero(ret);
-	update_section_info(ret, eid, va);
+	ebi_trace(TRACE_MEM, TRACE_EV_SEC_ALLOC, eid, va, ret << SECTION_SHIFT,
+		  0);
 	dump_section_ownership();
 	// PMP
 
@@ -191,7 +209,7 @@ found:
 
 void free_section_for_enclave(int eid)
 {
-	int i;
+	int i, count = 0;
 	section_t *sec;
 
 #ifdef EBI_DEBUG
@@ -204,15 +222,89 @@ void free_section_for_enclave(int eid)
 	{
 		if (sec->owner == eid) {
 			free_section(sec->sfn);
+			count++;
 		}
 	}
 	spin_unlock(&memory_pool_lock);
+	ebi_trace(TRACE_MEM, TRACE_EV_SEC_FREE, eid, count, 0, 0);
 
 #ifdef EBI_DEBUG
 	dump_section_ownership();
 #endif
 }
 
+/*
+ * Lend host sections to an enclave that has not been entered yet. `pa_list'
+ * is an 8-byte aligned array of section-aligned PAs in host memory, the
+ * enclave maps them in this order. Nothing is zeroed, the contents are the
+ * input. Returns the window size in bytes.
+ */
+uintptr_t share_sections_with_enclave(enclave_context_t *ectx,
+				     uintptr_t pa_list, uintptr_t count,
+				     uintptr_t mepc)
+{
+	uintptr_t pas[SHM_MAX_SECTIONS];
+	section_t *sec;
+	uintptr_t i;
+
+	if (!ectx || ectx->status != ENC_LOAD) {
+		sbi_error("Enclave must be loaded but not entered\n");
+		return EBI_ERROR;
+	}
+	if (!count || ectx->shm_cnt + count > SHM_MAX_SECTIONS ||
+	    (pa_list & (sizeof(uintptr_t) - 1))) {
+		sbi_error("Invalid section list\n");
+		return EBI_ERROR;
+	}
+	memcpy_from_user((uintptr_t)pas, pa_list, count * sizeof(uintptr_t),
+			 mepc);
+
+	// Tag as we check, so a section listed twice is caught too
+	spin_lock(&memory_pool_lock);
+	for (i = 0; i < count; i++) {
+		if ((pas[i] & (SECTION_SIZE - 1)) || pas[i] < MEMORY_POOL_START ||
+		    pas[i] >= MEMORY_POOL_END)
+			goto invalid;
+		sec = sfn_to_section(pas[i] >> SECTION_SHIFT);
+		if (sec->owner != 0 || sec->share >= 0)
+			goto invalid;
+		sec->share = ectx->id;
+	}
+	for (i = 0; i < count; i++) {
+		ectx->shm_sfn[ectx->shm_cnt++] = pas[i] >> SECTION_SHIFT;
+		pmp_allow_region(pas[i], SECTION_SIZE);
+	}
+	spin_unlock(&memory_pool_lock);
+
+	sbi_debug("enclave %ld: %ld shared sections\n", ectx->id, ectx->shm_cnt);
+	return ectx->shm_cnt << SECTION_SHIFT;
+
+invalid:
+	sbi_error("0x%lx is not a private host section\n", pas[i]);
+	while (i--) {
+		sec	   = sfn_to_section(pas[i] >> SECTION_SHIFT);
+		sec->share = -1;
+	}
+	spin_unlock(&memory_pool_lock);
+	return EBI_ERROR;
+}
+
+// Hand the window back to the host as is, it holds the enclave's output
+void unshare_sections_of_enclave(enclave_context_t *ectx)
+{
+	section_t *sec;
+	uintptr_t i;
+
+	spin_lock(&memory_pool_lock);
+	for (i = 0; i < ectx->shm_cnt; i++) {
+		sec = sfn_to_section(ectx->shm_sfn[i]);
+		if (sec->share == (int)ectx->id)
+			sec->share = -1;
+	}
+	ectx->shm_cnt = 0;
+	spin_unlock(&memory_pool_lock);
+}
+
 inverse_map_t *look_up_inverse_map(inverse_map_t *inv_map, uintptr_t pa)
 {
 	// region search
@@ -231,6 +323,11 @@ inverse_map_t *look_up_inverse_map(inverse_map_t *inv_map, uintptr_t pa)
 	return NULL;
 }
 
+/*
+ * Move enclave section `src_sfn' to `dst_sfn', which the caller claimed
+ * for `MIGRATE_OWNER' (see claim_section). Returns `dst_sfn', or 0 if the
+ * source cannot move; the destination goes back to the pool then.
+ */
 int section_migration(uintptr_t src_sfn, uintptr_t dst_sfn)
 {
 	section_t *src_sec	  = sfn_to_section(src_sfn);
@@ -238,34 +335,54 @@ int section_migration(uintptr_t src_sfn, uintptr_t dst_sfn)
 	uintptr_t src_pa	  = src_sfn << SECTION_SHIFT;
 	uintptr_t dst_pa	  = dst_sfn << SECTION_SHIFT;
 	uintptr_t pa_diff	  = dst_pa - src_pa;
-	uintptr_t src_owner	  = src_sec->owner;
-	uintptr_t linear_start_va = src_sec->va;
+	int src_owner		  = src_sec->owner;
 	uint32_t hartid		  = current_hartid();
 	uintptr_t eid		  = (uintptr_t)enclave_on_core[hartid];
-	enclave_context_t *ectx	  = eid_to_context(src_owner);
 	char is_base_module	  = 0;
+	enclave_context_t *ectx;
+	uintptr_t linear_start_va;
 	uintptr_t *pt_root_addr, *offset_addr;
 	inverse_map_t *inv_map_addr;
 	uintptr_t pt_root;
 	uintptr_t va;
-	uintptr_t satp;
+	uintptr_t satp = 0;
 	inverse_map_t *inv_map_entry;
+	uint64_t start = stats_start();
 
-	sbi_debug(
-		"src_pa = 0x%lx, dst_pa = px%lx, pa_diff = 0x%lx, owner: %d\n",
-		src_pa, dst_pa, pa_diff, src_sec->owner);
-	sbi_debug("src_owner = %ld\n", src_owner);
-	sbi_debug("linear_start_va = 0x%lx\n", linear_start_va);
+	if (dst_sec->owner != MIGRATE_OWNER) {
+		sbi_error("Destination section 0x%lx is not claimed!\n",
+			  dst_sfn);
+		return 0;
+	}
 
-	if (src_owner < 0 || ectx == NULL) {
+	// Channel sections are in two page tables, only one would be updated
+	ectx = src_owner > 0 && src_owner <= NUM_ENCLAVE ?
+		       eid_to_context(src_owner) :
+		       NULL;
+	if (ectx == NULL) {
 		sbi_error("Invalid EID or context!\n");
-		return 0;
+		goto fail;
 	}
 
-	if (dst_sec->owner >= 0) {
-		sbi_error("Destination section already occupied!\n");
-		return 0;
+	// 0. Park the other harts running the owner, so that nothing below
+	//    changes under us, then check that the source is still theirs
+	ebi_ipi_hold(src_owner);
+	spin_lock(&memory_pool_lock);
+	if (src_sec->owner != src_owner) {
+		spin_unlock(&memory_pool_lock);
+		ebi_ipi_release(0);
+		sbi_error("Section 0x%lx changed hands!\n", src_sfn);
+		goto fail;
 	}
+	linear_start_va = src_sec->va;
+	dst_sec->owner	= src_owner;
+	dst_sec->va	= linear_start_va;
+	spin_unlock(&memory_pool_lock);
+
+	sbi_debug(
+		"src_pa = 0x%lx, dst_pa = px%lx, pa_diff = 0x%lx, owner: %d\n",
+		src_pa, dst_pa, pa_diff, src_owner);
+	sbi_debug("linear_start_va = 0x%lx\n", linear_start_va);
 
 	pt_root_addr = (uintptr_t *)ectx->pt_root_addr;
 	inv_map_addr = (inverse_map_t *)ectx->inverse_map_addr;
@@ -278,10 +395,8 @@ int section_migration(uintptr_t src_sfn, uintptr_t dst_sfn)
 		is_base_module = 1;
 	}
 
-	// 2. Copy section content, set section VA&owner
+	// 2. Copy section content, the destination was claimed above
 	sbi_memcpy((void *)dst_pa, (void *)src_pa, SECTION_SIZE);
-	dst_sec->owner = src_owner;
-	dst_sec->va    = linear_start_va;
 
 	// 3. For base module, calculate the new PA of pt_root,
 	//    inv_map, and va_pa_offset.
@@ -302,14 +417,13 @@ int section_migration(uintptr_t src_sfn, uintptr_t dst_sfn)
 		pt_root = *pt_root_addr;
 		satp	= pt_root >> EPAGE_SHIFT;
 		satp |= (uintptr_t)SATP_MODE_SV39 << SATP_MODE_SHIFT;
-		if ((int)eid == src_sec->owner) {
+		if ((int)eid == src_owner) {
 			csr_write(CSR_SATP, satp);
 		} else {
 			sbi_debug("not owner.\n");
-			enclave_context_t *owner_context =
-				eid_to_context(src_sec->owner);
-			owner_context->ns_satp = satp;
+			ectx->ns_satp = satp;
 		}
+		enclave_rebase_threads(ectx, satp);
 		*offset_addr -= pa_diff;
 	}
 
@@ -349,8 +463,11 @@ int section_migration(uintptr_t src_sfn, uintptr_t dst_sfn)
 	free_section(src_sfn);
 	spin_unlock(&memory_pool_lock);
 
-	// 6. Flush TLB and D-cache
+	// 6. Flush TLB and D-cache, here and on the other harts of the owner
 	flush_tlb();
+	ebi_ipi_release(satp);
+	stats_migrated(src_owner);
+	stats_end(EBI_STAT_MIGRATION, start);
 	// flush_dcache_range(dst_pa, dst_pa + SECTION_SIZE);
 	// invalidate_dcache_range(src_pa, src_pa + SECTION_SIZE);
 	// if (!is_base_module) {
@@ -359,6 +476,12 @@ int section_migration(uintptr_t src_sfn, uintptr_t dst_sfn)
 	// }
 
 	return dst_sfn;
+
+fail:
+	spin_lock(&memory_pool_lock);
+	free_section(dst_sfn);
+	spin_unlock(&memory_pool_lock);
+	return 0;
 }
 
 void memcpy_from_user(uintptr_t maddr, uintptr_t uaddr, uintptr_t size,
@@ -389,6 +512,33 @@ void memcpy_from_user(uintptr_t maddr, uintptr_t uaddr, uintptr_t size,
 	}
 }
 
+void memcpy_to_user(uintptr_t uaddr, uintptr_t maddr, uintptr_t size,
+		    uintptr_t mepc)
+{
+	while (size > 0) {
+		/* 8 bytes per iter */
+		if (size >= 8) {
+			store_uint64_t((uint64_t *)uaddr, *(uint64_t *)maddr,
+				       mepc);
+			maddr += 8;
+			uaddr += 8;
+			size -= 8;
+		} else if (size >= 4) {
+			store_uint32_t((uint32_t *)uaddr, *(uint32_t *)maddr,
+				       mepc);
+			maddr += 4;
+			uaddr += 4;
+			size -= 4;
+		} else {
+			store_uint8_t((uint8_t *)uaddr, *(uint8_t *)maddr,
+				      mepc);
+			++maddr;
+			++uaddr;
+			--size;
+		}
+	}
+}
+
 void debug_memdump(uintptr_t addr, size_t size)
 {
 	uint32_t *ptr = (uint32_t *)addr;
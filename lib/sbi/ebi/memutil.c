@@ -1,5 +1,6 @@
 #include <sbi/ebi/memory.h>
 #include <sbi/ebi/memutil.h>
+#include <sbi/ebi/stats.h>
 #include <sbi/riscv_locks.h>
 #include <sbi/sbi_string.h>
 #include <sbi/riscv_encoding.h>
@@ -38,6 +39,34 @@ uint64_t load_uint64_t(const uint64_t *addr, uintptr_t mepc)
 	       ((uint64_t)load_uint32_t((uint32_t *)addr + 1, mepc) << 32);
 }
 
+void store_uint8_t(uint8_t *addr, uint8_t val, uintptr_t mepc)
+{
+	register uintptr_t __mepc asm("a2") = mepc;
+	register uintptr_t __mstatus asm("a3");
+	asm volatile("csrrs %0, mstatus, %3\n"
+		     "sb %2, %1\n"
+		     "csrw mstatus, %0"
+		     : "+&r"(__mstatus), "=m"(*addr)
+		     : "r"(val), "r"(MSTATUS_MPRV), "r"(__mepc));
+}
+
+void store_uint32_t(uint32_t *addr, uint32_t val, uintptr_t mepc)
+{
+	register uintptr_t __mepc asm("a2") = mepc;
+	register uintptr_t __mstatus asm("a3");
+	asm volatile("csrrs %0, mstatus, %3\n"
+		     "sw %2, %1\n"
+		     "csrw mstatus, %0"
+		     : "+&r"(__mstatus), "=m"(*addr)
+		     : "r"(val), "r"(MSTATUS_MPRV), "r"(__mepc));
+}
+
+void store_uint64_t(uint64_t *addr, uint64_t val, uintptr_t mepc)
+{
+	store_uint32_t((uint32_t *)addr, (uint32_t)val, mepc);
+	store_uint32_t((uint32_t *)addr + 1, (uint32_t)(val >> 32), mepc);
+}
+
 section_t *find_available_section()
 {
 	uintptr_t ret_sfn = 0;
@@ -55,24 +84,65 @@ section_t *find_available_section()
 	return sec;
 }
 
+/*
+ * Find a free section and give it to `owner' in one go: the search drops
+ * `memory_pool_lock', so a section taken by someone else meanwhile is
+ * skipped and the search starts over. NULL when the pool is full.
+ */
+section_t *claim_available_section(int owner, uintptr_t va)
+{
+	section_t *sec;
+
+	while ((sec = find_available_section())) {
+		if (claim_section(sec->sfn, owner, va))
+			return sec;
+	}
+	return NULL;
+}
+
+/*
+ * Give free section `sfn' to `owner'. Free sections are found by scans
+ * that do not hold `memory_pool_lock', so this is where two harts picking
+ * the same one are told apart: 0 if it is not free any more.
+ */
+int claim_section(uintptr_t sfn, int owner, uintptr_t va)
+{
+	section_t *sec = sfn_to_section(sfn);
+	int claimed    = 0;
+
+	spin_lock(&memory_pool_lock);
+	if (sec->owner < 0) {
+		sec->owner = owner;
+		sec->va	   = va;
+		claimed	   = 1;
+	}
+	spin_unlock(&memory_pool_lock);
+	return claimed;
+}
+
 uintptr_t alloc_section_for_host_os()
 {
 	int i;
-	section_t *sec;
+	section_t *sec, *migrate_to;
 
 	spin_lock(&memory_pool_lock);
 	for_each_section_in_pool_rev(memory_pool, sec, i)
 	{
-		if (sec->owner == 0)
-			continue;
-		spin_unlock(&memory_pool_lock);
-
-		if (sec->owner > 0) {
-			section_t *migrate_to = find_available_section();
-			section_migration(sec->sfn, migrate_to->sfn);
+		// Move an enclave section out of the way first. The section
+		// is only ours if it is free afterwards, whatever happened
+		if (sec->owner > 0 && sec->owner <= NUM_ENCLAVE) {
+			spin_unlock(&memory_pool_lock);
+			migrate_to = claim_available_section(MIGRATE_OWNER, 0);
+			if (migrate_to)
+				section_migration(sec->sfn, migrate_to->sfn);
+			spin_lock(&memory_pool_lock);
 		}
+		if (sec->owner >= 0)
+			continue;
 
-		update_section_info(sec->sfn, 0, 0);
+		sec->owner = 0;
+		sec->va	   = 0;
+		spin_unlock(&memory_pool_lock);
 		return sec->sfn << SECTION_SHIFT;
 	}
 
@@ -268,6 +338,7 @@ void page_compaction()
 	section_t *tmp;
 	int done = 1;
 	static int count = 0;
+	uint64_t start = stats_start();
 
 	dump_section_ownership();
 
@@ -279,8 +350,10 @@ void page_compaction()
 		if (sec->owner < 0) {
 			for (int j = 1; i + j < MEMORY_POOL_SECTION_NUM; j++) {
 				tmp = sfn_to_section(sec->sfn + j);
-				if (tmp->owner > 0) {
-					section_migration(tmp->sfn, sec->sfn);
+				if (tmp->owner > 0 &&
+				    tmp->owner <= NUM_ENCLAVE &&
+				    claim_section(sec->sfn, MIGRATE_OWNER, 0) &&
+				    section_migration(tmp->sfn, sec->sfn)) {
 					done = 0;
 					break;
 				}
@@ -289,11 +362,13 @@ void page_compaction()
 			if (done) {
 				count++;
 				dump_section_ownership();
+				stats_end(EBI_STAT_COMPACTION, start);
 				return;
 			}
 			
 		}
 	}
+	stats_end(EBI_STAT_COMPACTION, start);
 }
 
 void update_tree_pte(uintptr_t root, uintptr_t pa_diff)
@@ -354,16 +429,6 @@ void set_section_zero(uintptr_t sfn)
 	// sbi_debug("setting zero done\n");
 }
 
-void update_section_info(uintptr_t sfn, int owner, uintptr_t va)
-{
-	spin_lock(&memory_pool_lock);
-	section_t *sec = sfn_to_section(sfn);
-	spin_unlock(&memory_pool_lock);
-
-	sec->owner = owner;
-	sec->va	   = va;
-}
-
 void free_section(uintptr_t sfn)
 {
 	section_t *sec = sfn_to_section(sfn);
@@ -382,4 +447,5 @@ void free_section(uintptr_t sfn)
 
 	sec->owner = -1;
 	sec->va	   = 0;
+	sec->share = -1;
 }
\ No newline at end of file
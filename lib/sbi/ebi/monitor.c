@@ -1,5 +1,6 @@
 #include <sbi/ebi/monitor.h>
 #include <sbi/ebi/enclave.h>
+#include <sbi/ebi/memory.h>
 #include <sbi/sbi_console.h>
 
 __attribute__((unused)) void dump_enclave_status()
@@ -24,4 +25,30 @@ __attribute__((unused)) void dump_enclave_status()
 			break;
 		}
 	}
-}
\ No newline at end of file
+}
+
+/*
+ * Print `len' bytes at enclave VA `va', returns the number of bytes printed.
+ * `va' must be 8-byte aligned, `memcpy_from_user' copies whole words.
+ */
+uintptr_t enclave_puts(uintptr_t va, uintptr_t len, uintptr_t mepc)
+{
+	uint64_t words[EBI_PUTS_CHUNK / sizeof(uint64_t) + 1];
+	char *buf = (char *)words;
+	uintptr_t chunk, done = 0;
+
+	if (va & (sizeof(uint64_t) - 1)) {
+		sbi_error("unaligned buffer 0x%lx\n", va);
+		return 0;
+	}
+
+	len = MIN(len, EBI_PUTS_MAX);
+	while (done < len) {
+		chunk = MIN(len - done, EBI_PUTS_CHUNK);
+		memcpy_from_user((uintptr_t)buf, va + done, chunk, mepc);
+		buf[chunk] = '\0';
+		sbi_puts(buf);
+		done += chunk;
+	}
+	return done;
+}
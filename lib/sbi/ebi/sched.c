@@ -0,0 +1,138 @@
+#include <sbi/ebi/sched.h>
+#include <sbi/ebi/trace.h>
+#include <sbi/sbi_timer.h>
+#include <sbi/sbi_trap.h>
+
+/* Enclave picked last on each hart, the round robin starts after it */
+static uintptr_t sched_cursor[NUM_CORES];
+/* End of the running slice on each hart */
+static struct sbi_timer_event sched_event[NUM_CORES];
+
+static int sched_runnable(enclave_context_t *ectx, uint32_t hartid)
+{
+	if (ectx->status != ENC_IDLE)
+		return 0;
+	// The host is waiting for any hart an enclave took from it
+	if (!ectx->id)
+		return 1;
+	return ectx->sched.preempted && ectx->sched.hart == (int)hartid;
+}
+
+// End of a slice on this hart: switch to the most urgent runnable one
+static void sched_tick(struct sbi_timer_event *ev, struct sbi_trap_regs *regs)
+{
+	uint32_t hartid = current_hartid();
+	enclave_context_t *cur, *next = NULL, *e;
+	uintptr_t i, id;
+
+	if (thread_on_core[hartid])
+		return;
+	cur = eid_to_context(enclave_on_core[hartid]);
+	if (!cur->id || cur->status != ENC_RUN ||
+	    cur->sched.hart != (int)hartid)
+		return;
+	// Its threads would spin on whatever lock it holds
+	if (__atomic_load_n(&cur->n_threads, __ATOMIC_ACQUIRE)) {
+		sched_arm(cur);
+		return;
+	}
+
+	spin_lock(&enclave_lock);
+	for (i = 1; i <= NUM_ENCLAVE + 1; i++) {
+		id = (sched_cursor[hartid] + i) % (NUM_ENCLAVE + 1);
+		e  = &enclaves[id];
+		if (e == cur || !sched_runnable(e, hartid))
+			continue;
+		if (!next || e->sched.prio < next->sched.prio)
+			next = e;
+	}
+	if (!next || next->sched.prio > cur->sched.prio) {
+		spin_unlock(&enclave_lock);
+		sched_arm(cur);
+		return;
+	}
+	sched_cursor[hartid] = next->id;
+
+	sbi_debug("hart %u: slice of enclave %lx over, next is %lx\n", hartid,
+		  cur->id, next->id);
+	ebi_trace(TRACE_SCHED, TRACE_EV_SCHED, cur->id, next->id, 0, 0);
+	// Unlike an ecall, there is no instruction to step over either way
+	suspend_enclave(cur->id, regs, regs->mepc - 4);
+	cur->sched.preempted = 1;
+	resume_enclave(next->id, regs);
+	regs->mepc += 4;
+	spin_unlock(&enclave_lock);
+}
+
+void init_sched(void)
+{
+	int i;
+
+	sched_init_enclave(&enclaves[0]);
+	for (i = 0; i < NUM_CORES; i++)
+		SBI_TIMER_EVENT_INIT(&sched_event[i], sched_tick, NULL);
+}
+
+void sched_init_enclave(enclave_context_t *ectx)
+{
+	ectx->sched.hart       = -1;
+	ectx->sched.prio       = SCHED_PRIO_DEFAULT;
+	ectx->sched.quantum_us = SCHED_QUANTUM_US;
+	ectx->sched.preempted  = 0;
+}
+
+/*
+ * Slice enclave `eid' on `hart' with priority `prio' and a slice of
+ * `quantum_us', 0 for the default. A `hart' out of range stops slicing
+ * it. For the host, eid 0, only the priority applies.
+ */
+uintptr_t sched_set(uintptr_t eid, uintptr_t hart, uintptr_t prio,
+		    uintptr_t quantum_us)
+{
+	enclave_context_t *ectx;
+
+	if (eid > NUM_ENCLAVE || prio >= SCHED_PRIO_LEVELS ||
+	    (eid && !check_alive(eid)))
+		return EBI_ERROR;
+	ectx = eid_to_context(eid);
+
+	if (!quantum_us)
+		quantum_us = SCHED_QUANTUM_US;
+	if (quantum_us < SCHED_QUANTUM_MIN_US)
+		quantum_us = SCHED_QUANTUM_MIN_US;
+
+	spin_lock(&enclave_lock);
+	ectx->sched.prio = prio;
+	if (eid) {
+		ectx->sched.hart       = hart < NUM_CORES ? (int)hart : -1;
+		ectx->sched.quantum_us = quantum_us;
+	}
+	spin_unlock(&enclave_lock);
+	sbi_debug("enclave %lx: hart %d, prio %lu, slice %u us\n", eid,
+		  ectx->sched.hart, prio, ectx->sched.quantum_us);
+	return EBI_OK;
+}
+
+// `ectx' starts running on this hart: start its slice if it is sliced here
+void sched_arm(enclave_context_t *ectx)
+{
+	uint32_t hartid = current_hartid();
+	uint64_t ticks;
+
+	if (!ectx->id || ectx->sched.hart != (int)hartid) {
+		sched_disarm();
+		return;
+	}
+	ticks = (uint64_t)ectx->sched.quantum_us *
+		sbi_timer_get_timebase_freq() / 1000000;
+	if (sbi_timer_add(&sched_event[hartid], sbi_timer_value() + ticks))
+		sbi_error("hart %u: no room for the slice timer\n", hartid);
+}
+
+void sched_disarm(void)
+{
+	uint32_t hartid = current_hartid();
+
+	if (hartid < NUM_CORES)
+		sbi_timer_del(&sched_event[hartid]);
+}
@@ -0,0 +1,125 @@
+#include <sbi/ebi/enclave.h>
+#include <sbi/ebi/memory.h>
+#include <sbi/ebi/memutil.h>
+#include <sbi/ebi/stats.h>
+#include <sbi/sbi_string.h>
+
+static ebi_op_stat_t op_stats[EBI_STAT_OP_MAX];
+static uint32_t migrations[NUM_ENCLAVE + 1];
+
+// Any hart may account for any operation, so every update is atomic
+void stats_end(int op, uint64_t start)
+{
+	ebi_op_stat_t *s = &op_stats[op];
+	uint64_t cycles	 = csr_read(CSR_MCYCLE) - start;
+	uint64_t max	 = __atomic_load_n(&s->max, __ATOMIC_RELAXED);
+
+	__atomic_fetch_add(&s->count, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&s->total, cycles, __ATOMIC_RELAXED);
+	while (cycles > max &&
+	       !__atomic_compare_exchange_n(&s->max, &max, cycles, 1,
+					    __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
+// One section of `eid' moved elsewhere in the pool
+void stats_migrated(uintptr_t eid)
+{
+	if (eid <= NUM_ENCLAVE)
+		__atomic_fetch_add(&migrations[eid], 1, __ATOMIC_RELAXED);
+}
+
+void stats_enclave_reset(uintptr_t eid)
+{
+	if (eid <= NUM_ENCLAVE)
+		__atomic_store_n(&migrations[eid], 0, __ATOMIC_RELAXED);
+}
+
+// Section counts per owner and free runs, in one pass over the pool
+static void stats_scan_pool(ebi_stats_t *st, uint16_t *sections)
+{
+	section_t *sec;
+	uint32_t run = 0;
+	int i;
+
+	spin_lock(&memory_pool_lock);
+	for_each_section_in_pool(memory_pool, sec, i)
+	{
+		if (sec->owner < 0) {
+			st->pool_free++;
+			if (!run++)
+				st->pool_free_runs++;
+			st->pool_largest_run = MAX(st->pool_largest_run, run);
+			continue;
+		}
+		run = 0;
+		if (sec->owner <= NUM_ENCLAVE)
+			sections[sec->owner]++;
+	}
+	spin_unlock(&memory_pool_lock);
+}
+
+/*
+ * Copy the counters to the host buffer at VA `va', which must be 8-byte
+ * aligned. Enclave entries that do not fit in `len' are left out. Returns
+ * the bytes written, EBI_ERROR if the buffer is unaligned or not even the
+ * header fits; a1 is set to the size a complete copy needs either way.
+ * A non-zero `reset' clears the operation counters once they are copied.
+ */
+uintptr_t stats_copy_to_host(uintptr_t va, uintptr_t len, uintptr_t reset,
+			     struct sbi_trap_regs *regs, uintptr_t mepc)
+{
+	uint16_t sections[NUM_ENCLAVE + 1];
+	ebi_enclave_stat_t entry;
+	ebi_stats_t st;
+	uintptr_t off, eid, need;
+	int i;
+
+	need = sizeof(st);
+	for (eid = 0; eid <= NUM_ENCLAVE; eid++)
+		if (!eid || enclaves[eid].status != ENC_FREE)
+			need += sizeof(entry);
+	regs->a1 = need;
+	if (va & (sizeof(uint64_t) - 1)) {
+		sbi_error("unaligned buffer 0x%lx\n", va);
+		return EBI_ERROR;
+	}
+
+	sbi_memset(&st, 0, sizeof(st));
+	sbi_memset(sections, 0, sizeof(sections));
+	st.magic	 = EBI_STATS_MAGIC;
+	st.version	 = EBI_STATS_VERSION;
+	st.n_ops	 = EBI_STAT_OP_MAX;
+	st.pool_sections = MEMORY_POOL_SECTION_NUM;
+	for (i = 0; i < EBI_STAT_OP_MAX; i++) {
+		st.op[i].count = __atomic_load_n(&op_stats[i].count,
+						 __ATOMIC_RELAXED);
+		st.op[i].total = __atomic_load_n(&op_stats[i].total,
+						 __ATOMIC_RELAXED);
+		st.op[i].max   = __atomic_load_n(&op_stats[i].max,
+						 __ATOMIC_RELAXED);
+	}
+	stats_scan_pool(&st, sections);
+
+	if (len < sizeof(st))
+		return EBI_ERROR;
+
+	off = sizeof(st);
+	for (eid = 0; eid <= NUM_ENCLAVE && off + sizeof(entry) <= len; eid++) {
+		if (eid && enclaves[eid].status == ENC_FREE)
+			continue;
+		entry.eid	 = eid;
+		entry.status	 = enclaves[eid].status;
+		entry.sections	 = sections[eid];
+		entry.migrations = __atomic_load_n(&migrations[eid],
+						   __ATOMIC_RELAXED);
+		memcpy_to_user(va + off, (uintptr_t)&entry, sizeof(entry), mepc);
+		off += sizeof(entry);
+		st.n_enclaves++;
+	}
+	memcpy_to_user(va, (uintptr_t)&st, sizeof(st), mepc);
+
+	if (reset)
+		sbi_memset(op_stats, 0, sizeof(op_stats));
+	return off;
+}
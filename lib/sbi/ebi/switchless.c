@@ -0,0 +1,123 @@
+#include <sbi/ebi/switchless.h>
+#include <sbi/ebi/ocall.h>
+#include <sbi/ebi/enclave.h>
+#include <sbi/ebi/memory.h>
+#include <sbi/sbi_string.h>
+
+// PA of byte `off' of the enclave's shared window, 0 if outside of it
+static uintptr_t shm_offset_to_pa(enclave_context_t *ectx, uintptr_t off)
+{
+	uintptr_t idx = off >> SECTION_SHIFT;
+
+	if (idx >= ectx->shm_cnt)
+		return 0;
+	return (ectx->shm_sfn[idx] << SECTION_SHIFT) +
+	       (off & (SECTION_SIZE - 1));
+}
+
+/*
+ * Check that `size' bytes at `off' fit in the shared window and that the
+ * header at `off' does not straddle two sections, which may not be
+ * adjacent. Returns the PA of the header, 0 if the offset is invalid.
+ */
+static uintptr_t shm_place(enclave_context_t *ectx, uintptr_t off,
+			   uintptr_t hdr_size, uintptr_t size)
+{
+	uintptr_t pa = shm_offset_to_pa(ectx, off);
+
+	if (!pa || (off & (sizeof(sl_slot_t) - 1)) ||
+	    (off & (SECTION_SIZE - 1)) + hdr_size > SECTION_SIZE ||
+	    off + size > ectx->shm_cnt << SECTION_SHIFT) {
+		sbi_error("Invalid window offset 0x%lx\n", off);
+		return 0;
+	}
+	return pa;
+}
+
+static void sl_ring_init(sl_ring_t *ring)
+{
+	sbi_memset(ring, 0, sizeof(sl_ring_t));
+	ring->n_slots = SL_SLOTS;
+	__atomic_store_n(&ring->magic, SL_MAGIC, __ATOMIC_RELEASE);
+}
+
+/*
+ * Lay the call slots out at `off' in the shared window of an enclave that
+ * has not been entered yet, its base module picks the offset up at boot.
+ */
+uintptr_t switchless_setup(enclave_context_t *ectx, uintptr_t off)
+{
+	uintptr_t pa;
+
+	if (!ectx || ectx->status != ENC_LOAD || ectx->sl_ring_pa) {
+		sbi_error("Enclave must be loaded, without switchless slots\n");
+		return EBI_ERROR;
+	}
+	pa = shm_place(ectx, off, sizeof(sl_ring_t), sizeof(sl_ring_t));
+	if (!pa)
+		return EBI_ERROR;
+
+	sl_ring_init((sl_ring_t *)pa);
+	ectx->sl_ring_pa  = pa;
+	ectx->sl_ring_off = off;
+	sbi_debug("enclave %ld: %d slots at window offset 0x%lx\n", ectx->id,
+		  SL_SLOTS, off);
+	return EBI_OK;
+}
+
+/* Same for the OCALL area, header plus one bounce buffer per slot */
+uintptr_t ocall_setup(enclave_context_t *ectx, uintptr_t off)
+{
+	ocall_area_t *area;
+	uintptr_t pa;
+
+	if (!ectx || ectx->status != ENC_LOAD || ectx->oc_area_pa) {
+		sbi_error("Enclave must be loaded, without an OCALL area\n");
+		return EBI_ERROR;
+	}
+	pa = shm_place(ectx, off, sizeof(ocall_area_t), OCALL_AREA_SIZE);
+	if (!pa)
+		return EBI_ERROR;
+
+	area = (ocall_area_t *)pa;
+	sbi_memset(area, 0, sizeof(ocall_area_t));
+	sl_ring_init(&area->ring);
+	ectx->oc_area_pa  = pa;
+	ectx->oc_area_off = off;
+	sbi_debug("enclave %ld: OCALL area at window offset 0x%lx\n",
+		  ectx->id, off);
+	return EBI_OK;
+}
+
+/*
+ * Raise `stop': workers finish the call in hand and return from their loop,
+ * host threads stop posting. Waiting for `n_workers' to drop is left to
+ * the host, the monitor never spins on enclave progress.
+ */
+uintptr_t switchless_teardown(enclave_context_t *ectx)
+{
+	sl_ring_t *ring;
+
+	if (!ectx || !ectx->sl_ring_pa)
+		return EBI_ERROR;
+
+	ring = (sl_ring_t *)ectx->sl_ring_pa;
+	__atomic_store_n(&ring->stop, 1, __ATOMIC_RELEASE);
+	ectx->sl_ring_pa = 0;
+	sbi_debug("enclave %ld: %ld switchless calls served\n", ectx->id,
+		  ring->n_calls);
+	return EBI_OK;
+}
+
+// Stop the OCALL ring at exit, a host helper still polling it will notice
+void ocall_teardown(enclave_context_t *ectx)
+{
+	ocall_area_t *area = (ocall_area_t *)ectx->oc_area_pa;
+
+	if (!area)
+		return;
+	__atomic_store_n(&area->ring.stop, 1, __ATOMIC_RELEASE);
+	ectx->oc_area_pa = 0;
+	sbi_debug("enclave %ld: %d synchronous OCALLs\n", ectx->id,
+		  area->n_sync);
+}
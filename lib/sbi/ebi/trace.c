@@ -0,0 +1,118 @@
+#include <sbi/ebi/enclave.h>
+#include <sbi/ebi/trace.h>
+#include <sbi/riscv_asm.h>
+#include <sbi/sbi_timer.h>
+
+uint32_t trace_mask = TRACE_DEFAULT;
+
+static trace_ring_t trace_rings[NUM_CORES];
+
+/* Name of each event and how to print its arguments */
+static const struct {
+	const char *name;
+	const char *fmt;
+} trace_events[TRACE_EV_MAX] = {
+	[TRACE_EV_EBI_CALL]  = { "ebi_call", "func=%lu eid=%lu a0=0x%lx a1=0x%lx" },
+	[TRACE_EV_EBI_RET]   = { "ebi_ret", "func=%lu a0=0x%lx a1=0x%lx ret=%ld" },
+	[TRACE_EV_CREATE]    = { "create", "eid=%lu pa=0x%lx size=0x%lx" },
+	[TRACE_EV_ENTER]     = { "enter", "eid=%lu argc=%lu" },
+	[TRACE_EV_EXIT]	     = { "exit", "eid=%lu ret=0x%lx" },
+	[TRACE_EV_SUSPEND]   = { "suspend", "eid=%lu mepc=0x%lx" },
+	[TRACE_EV_RESUME]    = { "resume", "eid=%lu" },
+	[TRACE_EV_SEC_ALLOC] = { "sec_alloc", "eid=%lu va=0x%lx pa=0x%lx" },
+	[TRACE_EV_SEC_FREE]  = { "sec_free", "eid=%lu count=%lu" },
+	[TRACE_EV_COMPACT]   = { "compact", "eid=%lu" },
+	[TRACE_EV_SCHED]     = { "sched", "from=%lu to=%lu" },
+};
+
+// Only the local hart writes its ring, readers check `seq'
+void trace_record(uint32_t event, uintptr_t a0, uintptr_t a1, uintptr_t a2,
+		  uintptr_t a3)
+{
+	uint32_t hart = current_hartid();
+	trace_ring_t *ring;
+	trace_rec_t *rec;
+	uint64_t head;
+
+	if (hart >= NUM_CORES)
+		return;
+	ring = &trace_rings[hart];
+	head = ring->head;
+	rec  = &ring->rec[head & (TRACE_RING_SIZE - 1)];
+
+	__atomic_store_n(&rec->seq, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	rec->time   = sbi_timer_value();
+	rec->hart   = hart;
+	rec->event  = event;
+	rec->arg[0] = a0;
+	rec->arg[1] = a1;
+	rec->arg[2] = a2;
+	rec->arg[3] = a3;
+	__atomic_store_n(&rec->seq, head + 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+// Returns the previous mask
+uint32_t trace_set_mask(uint32_t mask)
+{
+	return __atomic_exchange_n(&trace_mask, mask & TRACE_ALL,
+				   __ATOMIC_RELAXED);
+}
+
+// Copy record `idx' of `ring' into `out', 0 if it was overwritten meanwhile
+static int trace_read(trace_ring_t *ring, uint64_t idx, trace_rec_t *out)
+{
+	trace_rec_t *rec = &ring->rec[idx & (TRACE_RING_SIZE - 1)];
+
+	if (__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) != idx + 1)
+		return 0;
+	*out = *rec;
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(&rec->seq, __ATOMIC_RELAXED) == idx + 1;
+}
+
+static void trace_dump_hart(uint32_t hart)
+{
+	trace_ring_t *ring = &trace_rings[hart];
+	uint64_t head	   = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	uint64_t idx, lost = 0;
+	trace_rec_t rec;
+
+	if (!head)
+		return;
+	idx = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+	sbi_printf("hart%u: %lu records, %lu overwritten\n", hart, head, idx);
+	for (; idx < head; idx++) {
+		if (!trace_read(ring, idx, &rec)) {
+			lost++;
+			continue;
+		}
+		sbi_printf("[%lu] hart%u %-10s ", rec.time, rec.hart,
+			   rec.event < TRACE_EV_MAX ?
+				   trace_events[rec.event].name :
+				   "?");
+		if (rec.event < TRACE_EV_MAX)
+			sbi_printf(trace_events[rec.event].fmt, rec.arg[0],
+				   rec.arg[1], rec.arg[2], rec.arg[3]);
+		sbi_printf("\n");
+	}
+	if (lost)
+		sbi_printf("hart%u: %lu records overwritten while dumping\n",
+			   hart, lost);
+}
+
+// Decode the ring of `hart', or of every hart for -1
+void trace_dump(uintptr_t hart)
+{
+	uint32_t i;
+
+	if (hart < NUM_CORES) {
+		trace_dump_hart(hart);
+		return;
+	}
+	if (hart != -1UL)
+		return;
+	for (i = 0; i < NUM_CORES; i++)
+		trace_dump_hart(i);
+}
@@ -49,3 +49,9 @@ libsbi-objs-y += ebi/memutil.o
 libsbi-objs-y += ebi/pmp.o
 libsbi-objs-y += ebi/debug.o
 libsbi-objs-y += ebi/monitor.o
+libsbi-objs-y += ebi/switchless.o
+libsbi-objs-y += ebi/channel.o
+libsbi-objs-y += ebi/sched.o
+libsbi-objs-y += ebi/ipi.o
+libsbi-objs-y += ebi/trace.o
+libsbi-objs-y += ebi/stats.o
@@ -11,6 +11,8 @@
 #include <sbi/sbi_ecall.h>
 #include <sbi/sbi_ecall_interface.h>
 #include <sbi/sbi_error.h>
+#include <sbi/sbi_hartmask.h>
+#include <sbi/sbi_scratch.h>
 #include <sbi/sbi_trap.h>
 #include <sbi/sbi_console.h>
 #include <sbi/riscv_encoding.h>
@@ -41,19 +43,114 @@ void sbi_ecall_set_impid(unsigned long impid)
 
 static SBI_LIST_HEAD(ecall_exts_list);
 
-struct sbi_ecall_extension *sbi_ecall_find_extension(unsigned long extid)
+static unsigned long ecall_stats_off;
+
+struct sbi_ecall_stats *sbi_ecall_stats_get(u32 hartid)
+{
+	struct sbi_scratch *scratch = sbi_hartid_to_scratch(hartid);
+
+	if (!scratch || !ecall_stats_off)
+		return NULL;
+
+	return sbi_scratch_offset_ptr(scratch, ecall_stats_off);
+}
+
+static void sbi_ecall_stats_add(enum sbi_ecall_stat_type type,
+				unsigned long start)
+{
+	struct sbi_ecall_stats *stats;
+
+	if (!ecall_stats_off)
+		return;
+
+	stats = sbi_scratch_offset_ptr(sbi_scratch_thishart_ptr(),
+				       ecall_stats_off);
+	stats->count[type]++;
+	stats->cycles[type] += csr_read(CSR_MCYCLE) - start;
+}
+
+void sbi_ecall_stats_dump(void)
+{
+	static const char *const names[SBI_ECALL_STAT_MAX] = {
+		"time", "ipi", "rfence", "slow"
+	};
+	struct sbi_ecall_stats *stats;
+	u32 hartid, type;
+
+	for (hartid = 0; hartid < SBI_HARTMASK_MAX_BITS; hartid++) {
+		stats = sbi_ecall_stats_get(hartid);
+		if (!stats)
+			continue;
+		for (type = 0; type < SBI_ECALL_STAT_MAX; type++) {
+			if (!stats->count[type])
+				continue;
+			sbi_printf("hart%u ecall %-6s: %lu calls, %lu cycles avg\n",
+				   hartid, names[type], stats->count[type],
+				   stats->cycles[type] / stats->count[type]);
+		}
+	}
+}
+
+/*
+ * Lookup tables, rebuilt from ecall_exts_list whenever it changes. Legacy
+ * and BASE IDs index ecall_direct; every other range sits in ecall_ranges,
+ * sorted by extid_start and searched by bisection. Registered ranges never
+ * overlap, so the bisection finds at most one match.
+ */
+#define SBI_ECALL_DIRECT_MAX	0x20
+#define SBI_ECALL_MAX_RANGES	16
+
+static struct sbi_ecall_extension *ecall_direct[SBI_ECALL_DIRECT_MAX];
+static struct sbi_ecall_extension *ecall_ranges[SBI_ECALL_MAX_RANGES];
+static unsigned int ecall_ranges_count;
+
+static void sbi_ecall_build_table(void)
 {
-	struct sbi_ecall_extension *t, *ret = NULL;
+	struct sbi_ecall_extension *t;
+	unsigned long id;
+	unsigned int i;
+
+	for (id = 0; id < SBI_ECALL_DIRECT_MAX; id++)
+		ecall_direct[id] = NULL;
+	ecall_ranges_count = 0;
 
 	sbi_list_for_each_entry(t, &ecall_exts_list, head)
 	{
-		if (t->extid_start <= extid && extid <= t->extid_end) {
-			ret = t;
-			break;
-		}
+		for (id = t->extid_start;
+		     id <= t->extid_end && id < SBI_ECALL_DIRECT_MAX; id++)
+			ecall_direct[id] = t;
+		if (t->extid_end < SBI_ECALL_DIRECT_MAX)
+			continue;
+
+		/* Insertion sort, there are only a handful of ranges */
+		i = ecall_ranges_count++;
+		for (; i && ecall_ranges[i - 1]->extid_start > t->extid_start;
+		     i--)
+			ecall_ranges[i] = ecall_ranges[i - 1];
+		ecall_ranges[i] = t;
 	}
+}
 
-	return ret;
+struct sbi_ecall_extension *sbi_ecall_find_extension(unsigned long extid)
+{
+	struct sbi_ecall_extension *t;
+	unsigned int lo = 0, hi = ecall_ranges_count, mid;
+
+	if (extid < SBI_ECALL_DIRECT_MAX)
+		return ecall_direct[extid];
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		t   = ecall_ranges[mid];
+		if (extid < t->extid_start)
+			hi = mid;
+		else if (t->extid_end < extid)
+			lo = mid + 1;
+		else
+			return t;
+	}
+
+	return NULL;
 }
 
 int sbi_ecall_register_extension(struct sbi_ecall_extension *ext)
@@ -73,8 +170,13 @@ int sbi_ecall_register_extension(struct sbi_ecall_extension *ext)
 			return SBI_EINVAL;
 	}
 
+	if (SBI_ECALL_DIRECT_MAX <= ext->extid_end &&
+	    SBI_ECALL_MAX_RANGES <= ecall_ranges_count)
+		return SBI_ENOSPC;
+
 	SBI_INIT_LIST_HEAD(&ext->head);
 	sbi_list_add_tail(&ext->head, &ecall_exts_list);
+	sbi_ecall_build_table();
 
 	return 0;
 }
@@ -95,8 +197,60 @@ void sbi_ecall_unregister_extension(struct sbi_ecall_extension *ext)
 		}
 	}
 
-	if (found)
+	if (found) {
 		sbi_list_del_init(&ext->head);
+		sbi_ecall_build_table();
+	}
+}
+
+/*
+ * Hot S-mode ecalls, straight from the trap vector. Only the caller-saved
+ * registers, MEPC and MSTATUS are in `regs', which is all the handlers of
+ * these extensions and sbi_trap_redirect() use. `start' is MCYCLE at entry.
+ */
+void sbi_ecall_fast_handler(struct sbi_trap_regs *regs, unsigned long start)
+{
+	int ret;
+	struct sbi_ecall_extension *ext;
+	enum sbi_ecall_stat_type type;
+	unsigned long extension_id = regs->a7;
+	unsigned long func_id	   = regs->a6;
+	struct sbi_trap_info trap  = { 0 };
+	unsigned long out_val	   = 0;
+
+	switch (extension_id) {
+	case SBI_EXT_0_1_SET_TIMER:
+		ext  = &ecall_legacy;
+		type = SBI_ECALL_STAT_TIME;
+		break;
+	case SBI_EXT_TIME:
+		ext  = &ecall_time;
+		type = SBI_ECALL_STAT_TIME;
+		break;
+	case SBI_EXT_IPI:
+		ext  = &ecall_ipi;
+		type = SBI_ECALL_STAT_IPI;
+		break;
+	default:
+		ext  = &ecall_rfence;
+		type = SBI_ECALL_STAT_RFENCE;
+		break;
+	}
+
+	ret = ext->handle(extension_id, func_id, regs, &out_val, &trap);
+	if (ret == SBI_ETRAP) {
+		trap.epc = regs->mepc;
+		sbi_trap_redirect(regs, &trap);
+	} else {
+		if (ret < SBI_LAST_ERR)
+			ret = SBI_ERR_FAILED;
+		regs->mepc += 4;
+		regs->a0 = ret;
+		if (extension_id != SBI_EXT_0_1_SET_TIMER)
+			regs->a1 = out_val;
+	}
+
+	sbi_ecall_stats_add(type, start);
 }
 
 int sbi_ecall_handler(struct sbi_trap_regs *regs)
@@ -108,10 +262,7 @@ int sbi_ecall_handler(struct sbi_trap_regs *regs)
 	struct sbi_trap_info trap  = { 0 };
 	unsigned long out_val	   = 0;
 	bool is_0_1_spec	   = 0;
-
-	if (extension_id == SBI_EXT_EBI) {
-		sbi_debug("Calling EBI with function ID=%lu\n", func_id);
-	}
+	unsigned long start	   = csr_read(CSR_MCYCLE);
 
 	ulong prev_mode = (regs->mstatus & MSTATUS_MPP) >> MSTATUS_MPP_SHIFT;
 	if (prev_mode == PRV_U && extension_id != SBI_EXT_EBI) {
@@ -135,10 +286,6 @@ int sbi_ecall_handler(struct sbi_trap_regs *regs)
 		ret = SBI_ENOTSUPP;
 	}
 
-	if (extension_id == SBI_EXT_EBI) {
-		sbi_debug("EBI ret = %d\n", ret);
-	}
-
 	if (ret == SBI_ETRAP) {
 		trap.epc = regs->mepc;
 		sbi_trap_redirect(regs, &trap);
@@ -158,28 +305,15 @@ int sbi_ecall_handler(struct sbi_trap_regs *regs)
 		 * case should be handled differently.
 		 */
 
-		if (extension_id == SBI_EXT_EBI)
-			sbi_debug("Ding\n");
 		regs->mepc += 4;
 		if (extension_id != SBI_EXT_EBI) {
 			regs->a0 = ret;
 			if (!is_0_1_spec)
 				regs->a1 = out_val;
 		}
-		if (extension_id == SBI_EXT_EBI)
-			sbi_debug("Dong\n");
 	}
 
-	if (extension_id == SBI_EXT_EBI) {
-		sbi_debug("Ret\n");
-		sbi_debug("regs->a1 = %lx\n", regs->a1);
-		sbi_debug("regs->a2 = %lx\n", regs->a2);
-		sbi_debug("regs->a3 = %lx\n", regs->a3);
-		sbi_debug("regs->a4 = %lx\n", regs->a4);
-		sbi_debug("regs->a5 = %lx\n", regs->a5);
-		sbi_debug("regs->a6 = %lx\n", regs->a6);
-		sbi_debug("mepc=%lx, mstatus=%lx\n", regs->mepc, regs->mstatus);
-	}
+	sbi_ecall_stats_add(SBI_ECALL_STAT_SLOW, start);
 
 	return 0;
 }
@@ -188,7 +322,12 @@ int sbi_ecall_init(void)
 {
 	int ret;
 
-	/* The order of below registrations is performance optimized */
+	ecall_stats_off = sbi_scratch_alloc_offset(sizeof(struct sbi_ecall_stats),
+						   "ECALL_STATS");
+	if (!ecall_stats_off)
+		return SBI_ENOMEM;
+
+	/* Lookup goes through the tables, registration order is free */
 	ret = sbi_ecall_register_extension(&ecall_time);
 	if (ret)
 		return ret;
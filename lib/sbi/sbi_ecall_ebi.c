@@ -5,9 +5,16 @@
 #include <sbi/sbi_version.h>
 #include <sbi/riscv_asm.h>
 #include <sbi/sbi_console.h>
+#include <sbi/sbi_timer.h>
 #include <sbi/ebi/enclave.h>
+#include <sbi/ebi/channel.h>
+#include <sbi/ebi/ipi.h>
 #include <sbi/ebi/memory.h>
+#include <sbi/ebi/sched.h>
 #include <sbi/ebi/debug.h>
+#include <sbi/ebi/monitor.h>
+#include <sbi/ebi/stats.h>
+#include <sbi/ebi/trace.h>
 #include <sbi/riscv_locks.h>
 
 // spinlock_t overall_lock;
@@ -20,146 +27,443 @@ static int hartid_to_eid(int hartid)
 	return enclave_on_core[hartid];
 }
 
+/* Caller state shared by all EBI function handlers */
+struct ebi_call {
+	struct sbi_trap_regs *regs;
+	ulong core;
+	ulong mepc;
+	int eid; // caller, 0 for the host
+	enclave_context_t *ectx;
+};
+
+typedef int (*ebi_func_t)(struct ebi_call *call);
+
+// Host calls on behalf of the enclave in a0, which must exist
+static bool ebi_from_host(struct ebi_call *call)
+{
+	struct sbi_trap_regs *regs = call->regs;
+
+	if (call->eid != 0 || regs->a0 < 1 || regs->a0 > NUM_ENCLAVE) {
+		regs->a0 = EBI_ERROR;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static int ebi_create(struct ebi_call *call)
+{
+	struct sbi_trap_regs *regs = call->regs;
+	uint64_t start		   = stats_start();
+	int ret;
+
+	sbi_debug("linux satp = 0x%lx\n", csr_read(CSR_SATP));
+	sbi_debug("SBI_EXT_EBI_CREATE\n");
+	sbi_debug(
+		"extid = %lu, funcid = 0x%lx, args[0] = 0x%lx, args[1] = 0x%lx, core = %lu\n",
+		regs->a7, regs->a6, regs->a0, regs->a1, call->core);
+	sbi_debug("_base_start @ %p, _base_end @ %p\n", &_base_start,
+		  &_base_end);
+	sbi_debug("_enclave_start @ %p, _enclave_end @ %p\n", &_enclave_start,
+		  &_enclave_end);
+	ret = create_enclave(regs, call->mepc);
+	stats_end(EBI_STAT_CREATE, start);
+	sbi_debug("after create_enclave\n");
+	sbi_debug("regs->a1 = %lx\n", regs->a1);
+	sbi_debug("regs->a2 = %lx\n", regs->a2);
+	sbi_debug("regs->a3 = %lx\n", regs->a3);
+	sbi_debug("regs->a4 = %lx\n", regs->a4);
+	sbi_debug("regs->a5 = %lx\n", regs->a5);
+	sbi_debug("regs->a6 = %lx\n", regs->a6);
+	sbi_debug("mepc=%lx, mstatus=%lx\n", csr_read(CSR_MEPC),
+		  csr_read(CSR_MSTATUS));
+	return ret;
+}
+
+static int ebi_enter(struct ebi_call *call)
+{
+	uint64_t start = stats_start();
+
+	sbi_debug("enter\n");
+	enter_enclave(call->regs, call->mepc);
+	stats_end(EBI_STAT_ENTER, start);
+	sbi_debug("back from enter_enclave\n");
+	sbi_debug("id = %lx, into->pa: 0x%lx\n", call->regs->a1,
+		  call->regs->a2);
+	return 0;
+}
+
+static int ebi_exit(struct ebi_call *call)
+{
+	uint64_t start = stats_start();
+
+	sbi_debug("enclave %lx exit\n", call->regs->a0);
+	exit_enclave(call->regs);
+	stats_end(EBI_STAT_EXIT, start);
+	return 0;
+}
+
+static int ebi_suspend(struct ebi_call *call)
+{
+	uint64_t start = stats_start();
+
+	// Only the main thread has a context the host can resume
+	if (thread_on_core[call->core]) {
+		call->regs->a0 = EBI_ERROR;
+		return 0;
+	}
+	sbi_debug("suspend enclave %x\n", call->eid);
+	suspend_enclave(call->eid, call->regs, call->mepc);
+	return_to_host(call->regs);
+	stats_end(EBI_STAT_SUSPEND, start);
+	return 0;
+}
+
+static int ebi_launch(struct ebi_call *call)
+{
+	// Host only: (eid, argc, argv, done_pa), returns the hart ID
+	if (call->eid != 0) {
+		call->regs->a0 = EBI_ERROR;
+		return 0;
+	}
+	call->regs->a0 = launch_enclave(call->regs, call->mepc);
+	return 0;
+}
+
+static int ebi_resume(struct ebi_call *call)
+{
+	struct sbi_trap_regs *regs = call->regs;
+	uint64_t start		   = stats_start();
+
+	sbi_debug("resume enclave %lx\n", regs->a0);
+	if (call->eid != 0) {
+		sbi_error("should call resume from Linux\n");
+		return 0;
+	}
+	suspend_enclave(0, regs, call->mepc);
+	if (resume_enclave(regs->a0, regs) == EBI_ERROR) {
+		resume_enclave(0, regs);
+	}
+	stats_end(EBI_STAT_RESUME, start);
+	return 0;
+}
+
+static int ebi_puts(struct ebi_call *call)
+{
+	call->regs->a0 =
+		enclave_puts(call->regs->a0, call->regs->a1, call->mepc);
+	return 0;
+}
+
+static int ebi_peri_inform(struct ebi_call *call)
+{
+	inform_peripheral(call->regs);
+	return 0;
+}
+
+static int ebi_fetch(struct ebi_call *call)
+{
+	sbi_debug("SBI_EXT_EBI_FETCH\n");
+	drv_fetch(call->regs->a0);
+	return 0;
+}
+
+static int ebi_release(struct ebi_call *call)
+{
+	sbi_debug("SBI_EXT_EBI_RELEASE\n");
+	drv_release(call->regs->a1);
+	return 0;
+}
+
+static int ebi_mem_alloc(struct ebi_call *call)
+{
+	struct sbi_trap_regs *regs = call->regs;
+	uint64_t start		   = stats_start();
+	uintptr_t pa;
+
+	sbi_debug("SBI_EXT_EBI_MEM_ALLOC\n");
+	// pa should be passed to enclave by regs
+	pa = alloc_section_for_enclave(call->ectx, regs->a0);
+	stats_end(EBI_STAT_MEM_ALLOC, start);
+	if (pa) {
+		regs->a1 = pa;
+		regs->a2 = SECTION_SIZE;
+	} else {
+		sbi_error("allocation failed\n");
+		while (1)
+			;
+		exit_enclave(regs);
+	}
+	return 0;
+}
+
+static int ebi_map_register(struct ebi_call *call)
+{
+	struct sbi_trap_regs *regs = call->regs;
+
+	sbi_debug("SBI_EXT_EBI_MAP_REGISTER\n");
+	sbi_debug("&pt_root = 0x%lx\n", regs->a0);
+	sbi_debug("&inv_map = 0x%lx\n", regs->a1);
+	sbi_debug("&ENC_VA_PA_OFFSET = 0x%lx\n", regs->a2);
+	if (!(regs->a0 && regs->a1 && regs->a2)) {
+		sbi_error("Invalid ecall, check input\n");
+		return SBI_ERR_INVALID_PARAM;
+	}
+	call->ectx->pt_root_addr     = regs->a0;
+	call->ectx->inverse_map_addr = regs->a1;
+	call->ectx->offset_addr	     = regs->a2;
+	return 0;
+}
+
+static int ebi_timebase(struct ebi_call *call)
+{
+	// Ticks per second of the `time' CSR, 0 if the FDT has none
+	call->regs->a1 = sbi_timer_get_timebase_freq();
+	sbi_debug("timebase-frequency = %lu\n", call->regs->a1);
+	return 0;
+}
+
+static int ebi_share(struct ebi_call *call)
+{
+	struct sbi_trap_regs *regs = call->regs;
+
+	// Host only: (eid, pa_list, count), returns the window size
+	if (ebi_from_host(call))
+		regs->a0 = share_sections_with_enclave(
+			eid_to_context(regs->a0), regs->a1, regs->a2,
+			call->mepc);
+	return 0;
+}
+
+static int ebi_share_info(struct ebi_call *call)
+{
+	struct sbi_trap_regs *regs = call->regs;
+	enclave_context_t *ectx	   = call->ectx;
+
+	// PA of the a0-th shared section (0 past the end), and the count
+	regs->a1 = regs->a0 < ectx->shm_cnt ?
+			   ectx->shm_sfn[regs->a0] << SECTION_SHIFT :
+			   0;
+	regs->a2 = ectx->shm_cnt;
+	// Window offset of the switchless slots, -1 if there are none
+	regs->a3 = ectx->sl_ring_pa ? ectx->sl_ring_off : -1UL;
+	// Window offset of the OCALL area, -1 if there is none
+	regs->a4 = ectx->oc_area_pa ? ectx->oc_area_off : -1UL;
+	return 0;
+}
+
+static int ebi_sl_setup(struct ebi_call *call)
+{
+	struct sbi_trap_regs *regs = call->regs;
+
+	// Host only: (eid, window offset)
+	if (ebi_from_host(call))
+		regs->a0 = switchless_setup(eid_to_context(regs->a0),
+					    regs->a1);
+	return 0;
+}
+
+static int ebi_sl_teardown(struct ebi_call *call)
+{
+	struct sbi_trap_regs *regs = call->regs;
+
+	// Host only: (eid)
+	if (ebi_from_host(call))
+		regs->a0 = switchless_teardown(eid_to_context(regs->a0));
+	return 0;
+}
+
+static int ebi_ocall_setup(struct ebi_call *call)
+{
+	struct sbi_trap_regs *regs = call->regs;
+
+	// Host only: (eid, window offset)
+	if (ebi_from_host(call))
+		regs->a0 = ocall_setup(eid_to_context(regs->a0), regs->a1);
+	return 0;
+}
+
+static int ebi_chan_open(struct ebi_call *call)
+{
+	// Enclave only: (peer eid), returns the channel ID and PA
+	call->regs->a0 = channel_open(call->ectx, call->regs->a0, call->regs);
+	return 0;
+}
+
+static int ebi_chan_notify(struct ebi_call *call)
+{
+	// Enclave only: (channel ID)
+	call->regs->a0 = call->eid ? channel_notify(call->ectx, call->regs->a0) :
+				     EBI_ERROR;
+	return 0;
+}
+
+static int ebi_chan_wait(struct ebi_call *call)
+{
+	struct sbi_trap_regs *regs = call->regs;
+
+	// Enclave only: (block), returns the doorbell mask in a1
+	regs->a1 = call->eid ? channel_take_bells(call->ectx) : 0;
+	if (regs->a1 || !regs->a0 || !call->eid || thread_on_core[call->core])
+		return 0;
+	// Nothing rung: resumes later with a1 == 0, the caller retries
+	suspend_enclave(call->eid, regs, call->mepc);
+	return_to_host(regs);
+	return 0;
+}
+
+static int ebi_chan_poll(struct ebi_call *call)
+{
+	struct sbi_trap_regs *regs = call->regs;
+
+	// Host only: (eid), doorbells of that enclave, not taken
+	if (ebi_from_host(call))
+		regs->a1 = __atomic_load_n(&eid_to_context(regs->a0)->chan_bell,
+					   __ATOMIC_ACQUIRE);
+	return 0;
+}
+
+static int ebi_thread_create(struct ebi_call *call)
+{
+	// Enclave only: (desc), returns the thread ID in a1
+	call->regs->a0 = call->eid ? thread_create(call->ectx, call->regs,
+						   call->mepc) :
+				     EBI_ERROR;
+	return 0;
+}
+
+static int ebi_thread_exit(struct ebi_call *call)
+{
+	// Secondary threads only, does not return on success
+	call->regs->a0 = call->eid ? thread_exit(call->ectx) : EBI_ERROR;
+	return 0;
+}
+
+static int ebi_sched_set(struct ebi_call *call)
+{
+	struct sbi_trap_regs *regs = call->regs;
+
+	// Host only: (eid, hart, prio, quantum_us)
+	regs->a0 = call->eid ?
+			   EBI_ERROR :
+			   sched_set(regs->a0, regs->a1, regs->a2, regs->a3);
+	return 0;
+}
+
+static int ebi_stop(struct ebi_call *call)
+{
+	// Host only: (eid, kill), wherever that enclave runs
+	call->regs->a0 = call->eid ? EBI_ERROR :
+				     ebi_ipi_stop(call->regs->a0, call->regs->a1);
+	return 0;
+}
+
+static int ebi_stats(struct ebi_call *call)
+{
+	struct sbi_trap_regs *regs = call->regs;
+
+	// Host only: (buf, len, reset), returns the bytes written
+	if (call->eid != 0) {
+		regs->a0 = EBI_ERROR;
+		return 0;
+	}
+	regs->a0 = stats_copy_to_host(regs->a0, regs->a1, regs->a2, regs,
+				      call->mepc);
+	return 0;
+}
+
+static int ebi_flush_dcache(struct ebi_call *call)
+{
+	// asm volatile(".word 0xFC000073"
+	// 	     :
+	// 	     :
+	// 	     : "memory"); // cflush.d.l1 zero
+	// TODO Clean L2?
+	return 0;
+}
+
+static int ebi_discard_dcache(struct ebi_call *call)
+{
+	asm volatile(".word 0xFC200073"
+		     :
+		     :
+		     : "memory"); // cdiscard.d.l1 zero
+	// TODO Clean L2?
+	return 0;
+}
+
+static int ebi_debug(struct ebi_call *call)
+{
+	enclave_debug(call->regs);
+	return 0;
+}
+
+/*
+ * Indexed by function ID, from SBI_EXT_EBI_START on. Holes are IDs that
+ * were never assigned, calling them does nothing, like before the table.
+ */
+#define EBI_FUNC(id) [(id) - SBI_EXT_EBI_START]
+#define EBI_NUM_FUNCS (SBI_EXT_EBI_DEBUG - SBI_EXT_EBI_START + 1)
+
+static const ebi_func_t ebi_funcs[EBI_NUM_FUNCS] = {
+	EBI_FUNC(SBI_EXT_EBI_CREATE)	     = ebi_create,
+	EBI_FUNC(SBI_EXT_EBI_ENTER)	     = ebi_enter,
+	EBI_FUNC(SBI_EXT_EBI_EXIT)	     = ebi_exit,
+	EBI_FUNC(SBI_EXT_EBI_LAUNCH)	     = ebi_launch,
+	EBI_FUNC(SBI_EXT_EBI_SUSPEND)	     = ebi_suspend,
+	EBI_FUNC(SBI_EXT_EBI_RESUME)	     = ebi_resume,
+	EBI_FUNC(SBI_EXT_EBI_MEM_ALLOC)	     = ebi_mem_alloc,
+	EBI_FUNC(SBI_EXT_EBI_MAP_REGISTER)   = ebi_map_register,
+	EBI_FUNC(SBI_EXT_EBI_TIMEBASE)	     = ebi_timebase,
+	EBI_FUNC(SBI_EXT_EBI_SHARE)	     = ebi_share,
+	EBI_FUNC(SBI_EXT_EBI_SHARE_INFO)     = ebi_share_info,
+	EBI_FUNC(SBI_EXT_EBI_PUTS)	     = ebi_puts,
+	EBI_FUNC(SBI_EXT_EBI_PERI_INFORM)    = ebi_peri_inform,
+	EBI_FUNC(SBI_EXT_EBI_FETCH)	     = ebi_fetch,
+	EBI_FUNC(SBI_EXT_EBI_RELEASE)	     = ebi_release,
+	EBI_FUNC(SBI_EXT_EBI_FLUSH_DCACHE)   = ebi_flush_dcache,
+	EBI_FUNC(SBI_EXT_EBI_DISCARD_DCACHE) = ebi_discard_dcache,
+	EBI_FUNC(SBI_EXT_EBI_SL_SETUP)	     = ebi_sl_setup,
+	EBI_FUNC(SBI_EXT_EBI_SL_TEARDOWN)    = ebi_sl_teardown,
+	EBI_FUNC(SBI_EXT_EBI_OCALL_SETUP)    = ebi_ocall_setup,
+	EBI_FUNC(SBI_EXT_EBI_CHAN_OPEN)	     = ebi_chan_open,
+	EBI_FUNC(SBI_EXT_EBI_CHAN_NOTIFY)    = ebi_chan_notify,
+	EBI_FUNC(SBI_EXT_EBI_CHAN_WAIT)	     = ebi_chan_wait,
+	EBI_FUNC(SBI_EXT_EBI_CHAN_POLL)	     = ebi_chan_poll,
+	EBI_FUNC(SBI_EXT_EBI_THREAD_CREATE)  = ebi_thread_create,
+	EBI_FUNC(SBI_EXT_EBI_THREAD_EXIT)    = ebi_thread_exit,
+	EBI_FUNC(SBI_EXT_EBI_SCHED_SET)	     = ebi_sched_set,
+	EBI_FUNC(SBI_EXT_EBI_STOP)	     = ebi_stop,
+	EBI_FUNC(SBI_EXT_EBI_STATS)	     = ebi_stats,
+	EBI_FUNC(SBI_EXT_EBI_DEBUG)	     = ebi_debug,
+};
+
 static int sbi_ecall_ebi_handler(unsigned long extid, unsigned long funcid,
 				 struct sbi_trap_regs *regs,
 				 unsigned long *out_val,
 				 struct sbi_trap_info *out_trap)
 {
-	int ret			= 0;
-	ulong core		= csr_read(CSR_MHARTID);
-	ulong mepc		= csr_read(CSR_MEPC);
-	int eid			= hartid_to_eid(core);
-	enclave_context_t *ectx = &enclaves[eid];
-	uintptr_t va, pa;
-
-#ifdef EBI_DEBUG
-	uintptr_t linux_satp = csr_read(CSR_SATP); //debug
-#endif
-
-	// spin_lock(&overall_lock);
-	switch (funcid) {
-	case SBI_EXT_EBI_CREATE:
-		sbi_debug("linux satp = 0x%lx\n", linux_satp);
-		sbi_debug("SBI_EXT_EBI_CREATE\n");
-		sbi_debug(
-			"extid = %lu, funcid = 0x%lx, args[0] = 0x%lx, args[1] = 0x%lx, core = %lu\n",
-			extid, funcid, regs->a0, regs->a1, core);
-		sbi_debug("_base_start @ %p, _base_end @ %p\n", &_base_start,
-			  &_base_end);
-		sbi_debug("_enclave_start @ %p, _enclave_end @ %p\n",
-			  &_enclave_start, &_enclave_end);
-		ret = create_enclave(regs, mepc);
-		sbi_debug("after create_enclave\n");
-		sbi_debug("regs->a1 = %lx\n", regs->a1);
-		sbi_debug("regs->a2 = %lx\n", regs->a2);
-		sbi_debug("regs->a3 = %lx\n", regs->a3);
-		sbi_debug("regs->a4 = %lx\n", regs->a4);
-		sbi_debug("regs->a5 = %lx\n", regs->a5);
-		sbi_debug("regs->a6 = %lx\n", regs->a6);
-		sbi_debug("mepc=%lx, mstatus=%lx\n", csr_read(CSR_MEPC),
-			  csr_read(CSR_MSTATUS));
-		break;
-
-	case SBI_EXT_EBI_ENTER:
-		sbi_debug("enter\n");
-		enter_enclave(regs, mepc);
-		sbi_debug("back from enter_enclave\n");
-		sbi_debug("id = %lx, into->pa: 0x%lx\n", regs->a1, regs->a2);
-		break;
-
-	case SBI_EXT_EBI_EXIT:
-		sbi_debug("enclave %lx exit\n", regs->a0);
-		exit_enclave(regs);
-		break;
+	struct ebi_call call;
+	ebi_func_t func;
+	int ret;
 
-	case SBI_EXT_EBI_SUSPEND:
-		sbi_debug("suspend enclave %x\n", eid);
-		suspend_enclave(eid, regs, mepc);
-		resume_enclave(0, regs);
-		break;
-
-	case SBI_EXT_EBI_RESUME:
-		sbi_debug("resume enclave %lx\n", regs->a0);
-		if (eid != 0) {
-			sbi_error("should call resume from Linux\n");
-			break;
-		}
-		suspend_enclave(0, regs, mepc);
-		if (resume_enclave(regs->a0, regs) == EBI_ERROR) {
-			resume_enclave(0, regs);
-		}
-		break;
-
-	case SBI_EXT_EBI_PERI_INFORM:
-		inform_peripheral(regs);
-		break;
-
-	case SBI_EXT_EBI_FETCH:
-		sbi_debug("SBI_EXT_EBI_FETCH\n");
-		uintptr_t drv_to_fetch = regs->a0;
-		drv_fetch(drv_to_fetch);
-		break;
-
-	case SBI_EXT_EBI_RELEASE:
-		sbi_debug("SBI_EXT_EBI_RELEASE\n");
-		uintptr_t drv_to_release = regs->a1;
-		drv_release(drv_to_release);
-		break;
-
-	case SBI_EXT_EBI_MEM_ALLOC:
-		sbi_debug("SBI_EXT_EBI_MEM_ALLOC\n");
-		;
-		va = regs->a0;
-		// pa should be passed to enclave by regs
-		pa = alloc_section_for_enclave(ectx, va);
-		if (pa) {
-			regs->a1 = pa;
-			regs->a2 = SECTION_SIZE;
-		} else {
-			sbi_error("allocation failed\n");
-			while (1)
-				;
-			exit_enclave(regs);
-		}
-		break;
-
-	case SBI_EXT_EBI_MAP_REGISTER:
-		sbi_debug("SBI_EXT_EBI_MAP_REGISTER\n");
-		sbi_debug("&pt_root = 0x%lx\n", regs->a0);
-		sbi_debug("&inv_map = 0x%lx\n", regs->a1);
-		sbi_debug("&ENC_VA_PA_OFFSET = 0x%lx\n", regs->a2);
-		if (!(regs->a0 && regs->a1 && regs->a2)) {
-			sbi_error("Invalid ecall, check input\n");
-			ret = SBI_ERR_INVALID_PARAM;
-			return ret;
-		}
-		ectx->pt_root_addr     = regs->a0;
-		ectx->inverse_map_addr = regs->a1;
-		ectx->offset_addr      = regs->a2;
-		break;
-
-	case SBI_EXT_EBI_FLUSH_DCACHE:
-		// asm volatile(".word 0xFC000073"
-		// 	     :
-		// 	     :
-		// 	     : "memory"); // cflush.d.l1 zero
-		// TODO Clean L2?
-		break;
-
-	case SBI_EXT_EBI_DISCARD_DCACHE:
-		asm volatile(".word 0xFC200073"
-			     :
-			     :
-			     : "memory"); // cdiscard.d.l1 zero
-		// TODO Clean L2?
-		break;
-
-	case SBI_EXT_EBI_DEBUG:
-		enclave_debug(regs);
-		break;
-	}
-	// spin_unlock(&overall_lock);
+	if (funcid < SBI_EXT_EBI_START ||
+	    funcid - SBI_EXT_EBI_START >= EBI_NUM_FUNCS)
+		return 0;
+	func = ebi_funcs[funcid - SBI_EXT_EBI_START];
+	if (!func)
+		return 0;
+
+	call.regs = regs;
+	call.core = csr_read(CSR_MHARTID);
+	call.mepc = csr_read(CSR_MEPC);
+	call.eid  = hartid_to_eid(call.core);
+	call.ectx = &enclaves[call.eid];
 
+	ebi_trace(TRACE_ECALL, TRACE_EV_EBI_CALL, funcid, call.eid, regs->a0,
+		  regs->a1);
+	ret = func(&call);
+	ebi_trace(TRACE_ECALL, TRACE_EV_EBI_RET, funcid, regs->a0, regs->a1,
+		  ret);
 	return ret;
 }
 
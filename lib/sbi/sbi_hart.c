@@ -57,6 +57,15 @@ static void mstatus_init(struct sbi_scratch *scratch)
 	if (sbi_hart_has_feature(scratch, SBI_HART_HAS_MCOUNTEREN))
 		csr_write(CSR_MCOUNTEREN, -1);
 
+	/* Let S-mode program its own timer compare */
+	if (sbi_hart_has_feature(scratch, SBI_HART_HAS_SSTC)) {
+#if __riscv_xlen == 32
+		csr_set(CSR_MENVCFGH, ENVCFGH_STCE);
+#else
+		csr_set(CSR_MENVCFG, ENVCFG_STCE);
+#endif
+	}
+
 	/* Disable all interrupts */
 	csr_write(CSR_MIE, 0);
 
@@ -265,6 +274,9 @@ static inline char *sbi_hart_feature_id2string(unsigned long feature)
 	case SBI_HART_HAS_TIME:
 		fstr = "time";
 		break;
+	case SBI_HART_HAS_SSTC:
+		fstr = "sstc";
+		break;
 	default:
 		break;
 	}
@@ -431,6 +443,15 @@ __mhpm_skip:
 	csr_read_allowed(CSR_TIME, (unsigned long)&trap);
 	if (!trap.cause)
 		hfeatures->features |= SBI_HART_HAS_TIME;
+
+	/* Detect if hart supports Sstc, menvcfg comes with it */
+	trap.cause = 0;
+	csr_read_allowed(CSR_STIMECMP, (unsigned long)&trap);
+	if (!trap.cause) {
+		csr_read_allowed(CSR_MENVCFG, (unsigned long)&trap);
+		if (!trap.cause)
+			hfeatures->features |= SBI_HART_HAS_SSTC;
+	}
 }
 
 int sbi_hart_init(struct sbi_scratch *scratch, bool cold_boot)
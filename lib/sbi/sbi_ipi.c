@@ -28,6 +28,8 @@ static unsigned long ipi_data_off;
 
 static const struct sbi_ipi_event_ops *ipi_ops_array[SBI_IPI_EVENT_MAX];
 
+static const struct sbi_ipi_smode_device *ipi_smode_dev = NULL;
+
 static int sbi_ipi_send(struct sbi_scratch *scratch, u32 remote_hartid,
 			u32 event, void *data)
 {
@@ -63,18 +65,14 @@ static int sbi_ipi_send(struct sbi_scratch *scratch, u32 remote_hartid,
 	smp_wmb();
 	sbi_platform_ipi_send(plat, remote_hartid);
 
-	if (ipi_ops->sync)
-		ipi_ops->sync(scratch);
-
 	return 0;
 }
 
-/**
- * As this this function only handlers scalar values of hart mask, it must be
- * set to all online harts if the intention is to send IPIs to all the harts.
- * If hmask is zero, no IPIs will be sent.
- */
-int sbi_ipi_send_many(ulong hmask, ulong hbase, u32 event, void *data)
+/* Call `send' for each started HART of the mask */
+static int sbi_ipi_send_mask(ulong hmask, ulong hbase, u32 event, void *data,
+			     int (*send)(struct sbi_scratch *scratch,
+					 u32 remote_hartid, u32 event,
+					 void *data))
 {
 	int rc;
 	ulong i, m;
@@ -90,7 +88,7 @@ int sbi_ipi_send_many(ulong hmask, ulong hbase, u32 event, void *data)
 		/* Send IPIs */
 		for (i = hbase; m; i++, m >>= 1) {
 			if (m & 1UL)
-				sbi_ipi_send(scratch, i, event, data);
+				send(scratch, i, event, data);
 		}
 	} else {
 		hbase = 0;
@@ -98,7 +96,7 @@ int sbi_ipi_send_many(ulong hmask, ulong hbase, u32 event, void *data)
 			/* Send IPIs */
 			for (i = hbase; m; i++, m >>= 1) {
 				if (m & 1UL)
-					sbi_ipi_send(scratch, i, event, data);
+					send(scratch, i, event, data);
 			}
 			hbase += BITS_PER_LONG;
 		}
@@ -107,11 +105,37 @@ int sbi_ipi_send_many(ulong hmask, ulong hbase, u32 event, void *data)
 	return 0;
 }
 
+/**
+ * As this this function only handlers scalar values of hart mask, it must be
+ * set to all online harts if the intention is to send IPIs to all the harts.
+ * If hmask is zero, no IPIs will be sent.
+ *
+ * IPIs go out to every target HART first, the sync callback then waits
+ * once for all of them instead of once per target.
+ */
+int sbi_ipi_send_many(ulong hmask, ulong hbase, u32 event, void *data)
+{
+	int rc;
+
+	if ((SBI_IPI_EVENT_MAX <= event) ||
+	    !ipi_ops_array[event])
+		return SBI_EINVAL;
+
+	rc = sbi_ipi_send_mask(hmask, hbase, event, data, sbi_ipi_send);
+	if (rc)
+		return rc;
+
+	if (ipi_ops_array[event]->sync)
+		ipi_ops_array[event]->sync(sbi_scratch_thishart_ptr());
+
+	return 0;
+}
+
 int sbi_ipi_event_create(const struct sbi_ipi_event_ops *ops)
 {
 	int i, ret = SBI_ENOSPC;
 
-	if (!ops || !ops->process)
+	if (!ops || (!ops->process && !ops->process_trap))
 		return SBI_EINVAL;
 
 	for (i = 0; i < SBI_IPI_EVENT_MAX; i++) {
@@ -145,11 +169,38 @@ static struct sbi_ipi_event_ops ipi_smode_ops = {
 
 static u32 ipi_smode_event = SBI_IPI_EVENT_MAX;
 
+/* Through the S-mode device if it covers the HART, else through M-mode */
+static int sbi_ipi_send_smode_direct(struct sbi_scratch *scratch,
+				     u32 remote_hartid, u32 event, void *data)
+{
+	if (!ipi_smode_dev->ipi_send(remote_hartid))
+		return 0;
+
+	return sbi_ipi_send(scratch, remote_hartid, event, data);
+}
+
 int sbi_ipi_send_smode(ulong hmask, ulong hbase)
 {
+	if (ipi_smode_dev)
+		return sbi_ipi_send_mask(hmask, hbase, ipi_smode_event, NULL,
+					 sbi_ipi_send_smode_direct);
+
 	return sbi_ipi_send_many(hmask, hbase, ipi_smode_event, NULL);
 }
 
+const struct sbi_ipi_smode_device *sbi_ipi_get_smode_device(void)
+{
+	return ipi_smode_dev;
+}
+
+void sbi_ipi_set_smode_device(const struct sbi_ipi_smode_device *dev)
+{
+	if (!dev || ipi_smode_dev)
+		return;
+
+	ipi_smode_dev = dev;
+}
+
 void sbi_ipi_clear_smode(void)
 {
 	csr_clear(CSR_MIP, MIP_SSIP);
@@ -172,7 +223,7 @@ int sbi_ipi_send_halt(ulong hmask, ulong hbase)
 	return sbi_ipi_send_many(hmask, hbase, ipi_halt_event, NULL);
 }
 
-void sbi_ipi_process(void)
+void sbi_ipi_process(struct sbi_trap_regs *regs)
 {
 	unsigned long ipi_type;
 	unsigned int ipi_event;
@@ -192,7 +243,9 @@ void sbi_ipi_process(void)
 			goto skip;
 
 		ipi_ops = ipi_ops_array[ipi_event];
-		if (ipi_ops && ipi_ops->process)
+		if (ipi_ops && regs && ipi_ops->process_trap)
+			ipi_ops->process_trap(scratch, regs);
+		else if (ipi_ops && ipi_ops->process)
 			ipi_ops->process(scratch);
 
 skip:
@@ -247,7 +300,7 @@ void sbi_ipi_exit(struct sbi_scratch *scratch)
 	csr_clear(CSR_MIE, MIP_MSIP);
 
 	/* Process pending IPIs */
-	sbi_ipi_process();
+	sbi_ipi_process(NULL);
 
 	/* Platform exit */
 	sbi_platform_ipi_exit(sbi_platform_ptr(scratch));
@@ -14,10 +14,27 @@
 #include <sbi/sbi_platform.h>
 #include <sbi/sbi_scratch.h>
 #include <sbi/sbi_timer.h>
+#include <sbi/sbi_trap.h>
 
 static unsigned long time_delta_off;
+static unsigned long time_queue_off;
+static unsigned long timebase_freq;
 static u64 (*get_time_val)(const struct sbi_platform *plat);
 
+/*
+ * Per-HART timer queue. The HART has one timer compare, shared by the
+ * deadline S-mode asked for and the firmware's own events, so all of them
+ * sit in a min-heap on their deadline and the compare holds the earliest.
+ * With Sstc S-mode has a compare of its own (stimecmp): the queue then
+ * only holds firmware events and S-mode deadlines never go through it.
+ */
+struct time_queue {
+	u64 programmed; /* deadline in the compare, -1ULL if disabled */
+	u32 count;
+	struct sbi_timer_event s_event; /* on behalf of S-mode */
+	struct sbi_timer_event *heap[SBI_TIMER_EVENT_MAX];
+};
+
 #if __riscv_xlen == 32
 static u64 get_ticks(const struct sbi_platform *plat)
 {
@@ -69,6 +86,16 @@ void sbi_timer_set_delta(ulong delta)
 	*time_delta = (u64)delta;
 }
 
+unsigned long sbi_timer_get_timebase_freq(void)
+{
+	return timebase_freq;
+}
+
+void sbi_timer_set_timebase_freq(unsigned long freq)
+{
+	timebase_freq = freq;
+}
+
 void sbi_timer_set_delta_upper(ulong delta_upper)
 {
 	u64 *time_delta = sbi_scratch_offset_ptr(sbi_scratch_thishart_ptr(),
@@ -78,21 +105,191 @@ void sbi_timer_set_delta_upper(ulong delta_upper)
 	*time_delta |= ((u64)delta_upper << 32);
 }
 
-void sbi_timer_event_start(u64 next_event)
+static bool time_has_sstc(void)
 {
-	sbi_platform_timer_event_start(sbi_platform_thishart_ptr(), next_event);
-	csr_clear(CSR_MIP, MIP_STIP);
+	return sbi_hart_has_feature(sbi_scratch_thishart_ptr(),
+				    SBI_HART_HAS_SSTC);
+}
+
+static u64 time_sstc_read(void)
+{
+#if __riscv_xlen == 32
+	u32 lo, hi;
+
+	do {
+		hi = csr_read(CSR_STIMECMPH);
+		lo = csr_read(CSR_STIMECMP);
+	} while (hi != csr_read(CSR_STIMECMPH));
+
+	return ((u64)hi << 32) | lo;
+#else
+	return csr_read(CSR_STIMECMP);
+#endif
+}
+
+static void time_sstc_write(u64 deadline)
+{
+#if __riscv_xlen == 32
+	/* Never a transient value below both the old and the new one */
+	csr_write(CSR_STIMECMP, -1UL);
+	csr_write(CSR_STIMECMPH, (u32)(deadline >> 32));
+	csr_write(CSR_STIMECMP, (u32)deadline);
+#else
+	csr_write(CSR_STIMECMP, deadline);
+#endif
+}
+
+u64 sbi_timer_smode_get(void)
+{
+	return time_has_sstc() ? time_sstc_read() : -1ULL;
+}
+
+void sbi_timer_smode_set(u64 deadline)
+{
+	if (time_has_sstc())
+		time_sstc_write(deadline);
+}
+
+static struct time_queue *time_queue_thishart(void)
+{
+	return sbi_scratch_offset_ptr(sbi_scratch_thishart_ptr(),
+				      time_queue_off);
+}
+
+static void time_queue_swap(struct time_queue *q, u32 i, u32 j)
+{
+	struct sbi_timer_event *ev = q->heap[i];
+
+	q->heap[i]	  = q->heap[j];
+	q->heap[j]	  = ev;
+	q->heap[i]->index = i;
+	q->heap[j]->index = j;
+}
+
+static void time_queue_up(struct time_queue *q, u32 i)
+{
+	while (i && q->heap[i]->deadline < q->heap[(i - 1) / 2]->deadline) {
+		time_queue_swap(q, i, (i - 1) / 2);
+		i = (i - 1) / 2;
+	}
+}
+
+static void time_queue_down(struct time_queue *q, u32 i)
+{
+	u32 child;
+
+	while ((child = 2 * i + 1) < q->count) {
+		if (child + 1 < q->count &&
+		    q->heap[child + 1]->deadline < q->heap[child]->deadline)
+			child++;
+		if (q->heap[i]->deadline <= q->heap[child]->deadline)
+			break;
+		time_queue_swap(q, i, child);
+		i = child;
+	}
+}
+
+static void time_queue_remove(struct time_queue *q, u32 i)
+{
+	q->heap[i]->index = -1;
+	if (i != --q->count) {
+		q->heap[i]	  = q->heap[q->count];
+		q->heap[i]->index = i;
+		time_queue_up(q, i);
+		time_queue_down(q, i);
+	}
+}
+
+/* Program the compare, only when the earliest deadline changed */
+static void time_queue_program(struct time_queue *q)
+{
+	u64 next = q->count ? q->heap[0]->deadline : -1ULL;
+
+	if (next == q->programmed)
+		return;
+	q->programmed = next;
+	if (next == -1ULL) {
+		csr_clear(CSR_MIE, MIP_MTIP);
+		return;
+	}
+	sbi_platform_timer_event_start(sbi_platform_thishart_ptr(), next);
 	csr_set(CSR_MIE, MIP_MTIP);
 }
 
-void sbi_timer_process(void)
+static bool time_queue_has(struct time_queue *q, struct sbi_timer_event *ev)
+{
+	return ev->index >= 0 && (u32)ev->index < q->count &&
+	       q->heap[ev->index] == ev;
+}
+
+int sbi_timer_add(struct sbi_timer_event *ev, u64 deadline)
+{
+	struct time_queue *q = time_queue_thishart();
+
+	if (time_queue_has(q, ev))
+		time_queue_remove(q, ev->index);
+	if (q->count == SBI_TIMER_EVENT_MAX)
+		return SBI_ENOSPC;
+
+	ev->deadline	   = deadline;
+	ev->index	   = q->count;
+	q->heap[q->count++] = ev;
+	time_queue_up(q, ev->index);
+	time_queue_program(q);
+	return 0;
+}
+
+void sbi_timer_del(struct sbi_timer_event *ev)
+{
+	struct time_queue *q = time_queue_thishart();
+
+	if (!time_queue_has(q, ev))
+		return;
+	time_queue_remove(q, ev->index);
+	time_queue_program(q);
+}
+
+static void time_s_event_fire(struct sbi_timer_event *ev,
+			      struct sbi_trap_regs *regs)
 {
-	csr_clear(CSR_MIE, MIP_MTIP);
 	csr_set(CSR_MIP, MIP_STIP);
 }
 
+void sbi_timer_event_start(u64 next_event)
+{
+	struct time_queue *q = time_queue_thishart();
+
+	/* STIP follows stimecmp in hardware, M-mode is not involved */
+	if (time_has_sstc()) {
+		time_sstc_write(next_event);
+		return;
+	}
+
+	csr_clear(CSR_MIP, MIP_STIP);
+	sbi_timer_add(&q->s_event, next_event);
+}
+
+void sbi_timer_process(struct sbi_trap_regs *regs)
+{
+	struct time_queue *q = time_queue_thishart();
+	struct sbi_timer_event *ev;
+	u64 now = sbi_timer_value();
+
+	/* Callbacks may add events again, those due already run right away */
+	while (q->count && q->heap[0]->deadline <= now) {
+		ev = q->heap[0];
+		time_queue_remove(q, 0);
+		ev->fn(ev, regs);
+		now = sbi_timer_value();
+	}
+	/* The compare fired, it has to be written even for the same value */
+	q->programmed = 0;
+	time_queue_program(q);
+}
+
 int sbi_timer_init(struct sbi_scratch *scratch, bool cold_boot)
 {
+	struct time_queue *q;
 	u64 *time_delta;
 	const struct sbi_platform *plat = sbi_platform_ptr(scratch);
 	int ret;
@@ -102,18 +299,31 @@ int sbi_timer_init(struct sbi_scratch *scratch, bool cold_boot)
 							  "TIME_DELTA");
 		if (!time_delta_off)
 			return SBI_ENOMEM;
+		time_queue_off = sbi_scratch_alloc_offset(sizeof(*q),
+							  "TIME_QUEUE");
+		if (!time_queue_off)
+			return SBI_ENOMEM;
 	} else {
-		if (!time_delta_off)
+		if (!time_delta_off || !time_queue_off)
 			return SBI_ENOMEM;
 	}
 
 	time_delta = sbi_scratch_offset_ptr(scratch, time_delta_off);
 	*time_delta = 0;
+	q		= sbi_scratch_offset_ptr(scratch, time_queue_off);
+	q->programmed	= -1ULL;
+	q->count	= 0;
+	q->s_event.fn	= time_s_event_fire;
+	q->s_event.index = -1;
 
 	ret = sbi_platform_timer_init(plat, cold_boot);
 	if (ret)
 		return ret;
 
+	/* The reset value of stimecmp is unspecified */
+	if (sbi_hart_has_feature(scratch, SBI_HART_HAS_SSTC))
+		time_sstc_write(-1ULL);
+
 	if (sbi_hart_has_feature(scratch, SBI_HART_HAS_TIME))
 		get_time_val = get_ticks;
 	else if (sbi_platform_has_timer_value(plat))
@@ -129,7 +339,10 @@ void sbi_timer_exit(struct sbi_scratch *scratch)
 {
 	sbi_platform_timer_event_stop(sbi_platform_ptr(scratch));
 
-	csr_clear(CSR_MIP, MIP_STIP);
+	if (sbi_hart_has_feature(scratch, SBI_HART_HAS_SSTC))
+		time_sstc_write(-1ULL);
+	else
+		csr_clear(CSR_MIP, MIP_STIP);
 	csr_clear(CSR_MIE, MIP_MTIP);
 
 	sbi_platform_timer_exit(sbi_platform_ptr(scratch));
@@ -23,10 +23,158 @@
 #include <sbi/sbi_platform.h>
 
 static unsigned long tlb_sync_off;
-static unsigned long tlb_fifo_off;
-static unsigned long tlb_fifo_mem_off;
+static unsigned long tlb_ring_off;
 static unsigned long tlb_range_flush_limit;
 
+#define TLB_CACHELINE		64
+#define TLB_SLOT_BUSY		(1UL << (__riscv_xlen - 1))
+
+/* Pages flushed one by one to time a page-wise flush at boot */
+#define TLB_PROBE_PAGES		32
+/* Never flush page-wise beyond a megapage */
+#define TLB_PROBE_LIMIT_MAX	(512 * PAGE_SIZE)
+
+/*
+ * Completion of the requests a HART sent: every remote HART done with
+ * one bumps `acks', the sender waits for the `expected' count once all
+ * of its IPIs are out.
+ */
+struct tlb_sync {
+	atomic_t acks;
+	unsigned long expected;
+};
+
+/*
+ * Per-HART queue of flush requests: a bounded ring, many producers (the
+ * HARTs asking for flushes) and one consumer (the HART itself). Each slot
+ * carries a sequence number; slot i is free for the producer of position
+ * pos when seq == pos, holds its request when seq == pos + 1, and is free
+ * again for pos + SBI_TLB_RING_NUM_ENTRIES once consumed. A producer
+ * merging into a queued request, or the consumer taking it, marks the
+ * slot busy with TLB_SLOT_BUSY in seq for that short while. There is no
+ * queue-wide lock, producers only contend on `tail' and on slots.
+ */
+struct tlb_slot {
+	unsigned long seq;
+	struct sbi_tlb_info info;
+} __attribute__((aligned(TLB_CACHELINE)));
+
+struct tlb_ring {
+	unsigned long tail __attribute__((aligned(TLB_CACHELINE)));
+	unsigned long head __attribute__((aligned(TLB_CACHELINE)));
+	struct tlb_slot slot[SBI_TLB_RING_NUM_ENTRIES];
+};
+
+/* Scratch space is only pointer aligned */
+static struct tlb_ring *tlb_ring_ptr(struct sbi_scratch *scratch)
+{
+	unsigned long p = (unsigned long)sbi_scratch_offset_ptr(scratch,
+							       tlb_ring_off);
+
+	return (struct tlb_ring *)((p + TLB_CACHELINE - 1) &
+				   ~(TLB_CACHELINE - 1));
+}
+
+/* Word-wise, the request is a multiple of the word size */
+static void tlb_info_copy(struct sbi_tlb_info *dst,
+			  const struct sbi_tlb_info *src)
+{
+	unsigned long *d = (unsigned long *)dst;
+	const unsigned long *s = (const unsigned long *)src;
+	unsigned long i;
+
+	for (i = 0; i < sizeof(*dst) / sizeof(unsigned long); i++)
+		d[i] = s[i];
+}
+
+/* Consumer: take the oldest request, SBI_ENOENT if the ring is empty */
+static int tlb_ring_dequeue(struct tlb_ring *ring, struct sbi_tlb_info *out)
+{
+	unsigned long pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+	struct tlb_slot *slot = &ring->slot[pos % SBI_TLB_RING_NUM_ENTRIES];
+	unsigned long seq;
+
+	do {
+		seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		if ((seq & ~TLB_SLOT_BUSY) != pos + 1)
+			return SBI_ENOENT;
+		/* Busy: a producer is merging into it, that is short */
+	} while (seq != pos + 1 ||
+		 !__atomic_compare_exchange_n(&slot->seq, &seq,
+					      seq | TLB_SLOT_BUSY, 0,
+					      __ATOMIC_ACQUIRE,
+					      __ATOMIC_RELAXED));
+
+	tlb_info_copy(out, &slot->info);
+	/* Producers read `head' in tlb_ring_inplace_update() */
+	__atomic_store_n(&ring->head, pos + 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&slot->seq, pos + SBI_TLB_RING_NUM_ENTRIES,
+			 __ATOMIC_RELEASE);
+	return 0;
+}
+
+/* Producer: queue a request, SBI_ENOSPC if the ring is full */
+static int tlb_ring_enqueue(struct tlb_ring *ring,
+			    const struct sbi_tlb_info *in)
+{
+	unsigned long pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+	struct tlb_slot *slot;
+	unsigned long seq;
+
+	while (1) {
+		slot = &ring->slot[pos % SBI_TLB_RING_NUM_ENTRIES];
+		seq  = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		if (seq == pos) {
+			if (__atomic_compare_exchange_n(&ring->tail, &pos,
+							pos + 1, 0,
+							__ATOMIC_RELAXED,
+							__ATOMIC_RELAXED))
+				break;
+			/* `pos' now holds the current tail */
+		} else if ((long)((seq & ~TLB_SLOT_BUSY) - pos) <= 0) {
+			return SBI_ENOSPC;
+		} else {
+			pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+		}
+	}
+
+	tlb_info_copy(&slot->info, in);
+	__atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+/*
+ * Producer: try to merge a request into one still queued, see
+ * sbi_tlb_update_cb(). Returns SBI_FIFO_UNCHANGED if it has to be queued.
+ */
+static int tlb_ring_inplace_update(struct tlb_ring *ring,
+				   struct sbi_tlb_info *in,
+				   int (*fptr)(void *in, void *data))
+{
+	unsigned long pos, tail, seq;
+	struct tlb_slot *slot;
+	int ret;
+
+	tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	pos  = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	for (; pos != tail; pos++) {
+		slot = &ring->slot[pos % SBI_TLB_RING_NUM_ENTRIES];
+		seq  = pos + 1;
+		/* Consumed, recycled or busy: leave it */
+		if (!__atomic_compare_exchange_n(&slot->seq, &seq,
+						 seq | TLB_SLOT_BUSY, 0,
+						 __ATOMIC_ACQUIRE,
+						 __ATOMIC_RELAXED))
+			continue;
+		ret = fptr(in, &slot->info);
+		__atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+		if (ret != SBI_FIFO_UNCHANGED)
+			return ret;
+	}
+
+	return SBI_FIFO_UNCHANGED;
+}
+
 static void sbi_tlb_flush_all(void)
 {
 	__asm__ __volatile("sfence.vma");
@@ -179,7 +327,7 @@ static void sbi_tlb_entry_process(struct sbi_tlb_info *tinfo)
 {
 	u32 rhartid;
 	struct sbi_scratch *rscratch = NULL;
-	unsigned long *rtlb_sync = NULL;
+	struct tlb_sync *rtlb_sync = NULL;
 
 	tinfo->local_fn(tinfo);
 
@@ -189,7 +337,7 @@ static void sbi_tlb_entry_process(struct sbi_tlb_info *tinfo)
 			continue;
 
 		rtlb_sync = sbi_scratch_offset_ptr(rscratch, tlb_sync_off);
-		while (atomic_raw_xchg_ulong(rtlb_sync, 1)) ;
+		atomic_add_return(&rtlb_sync->acks, 1);
 	}
 }
 
@@ -197,10 +345,9 @@ static void sbi_tlb_process_count(struct sbi_scratch *scratch, int count)
 {
 	struct sbi_tlb_info tinfo;
 	u32 deq_count = 0;
-	struct sbi_fifo *tlb_fifo =
-			sbi_scratch_offset_ptr(scratch, tlb_fifo_off);
+	struct tlb_ring *tlb_ring = tlb_ring_ptr(scratch);
 
-	while (!sbi_fifo_dequeue(tlb_fifo, &tinfo)) {
+	while (!tlb_ring_dequeue(tlb_ring, &tinfo)) {
 		sbi_tlb_entry_process(&tinfo);
 		deq_count++;
 		if (deq_count > count)
@@ -212,26 +359,29 @@ static void sbi_tlb_process_count(struct sbi_scratch *scratch, int count)
 static void sbi_tlb_process(struct sbi_scratch *scratch)
 {
 	struct sbi_tlb_info tinfo;
-	struct sbi_fifo *tlb_fifo =
-			sbi_scratch_offset_ptr(scratch, tlb_fifo_off);
+	struct tlb_ring *tlb_ring = tlb_ring_ptr(scratch);
 
-	while (!sbi_fifo_dequeue(tlb_fifo, &tinfo))
+	while (!tlb_ring_dequeue(tlb_ring, &tinfo))
 		sbi_tlb_entry_process(&tinfo);
 }
 
 static void sbi_tlb_sync(struct sbi_scratch *scratch)
 {
-	unsigned long *tlb_sync =
+	struct tlb_sync *tlb_sync =
 			sbi_scratch_offset_ptr(scratch, tlb_sync_off);
 
-	while (!atomic_raw_xchg_ulong(tlb_sync, 0)) {
+	while (atomic_read(&tlb_sync->acks) < (long)tlb_sync->expected) {
 		/*
-		 * While we are waiting for remote hart to set the sync,
-		 * consume fifo requests to avoid deadlock.
+		 * While we are waiting for remote harts to ack,
+		 * consume ring requests to avoid deadlock.
 		 */
 		sbi_tlb_process_count(scratch, 1);
 	}
 
+	/* Every ack owed has arrived, none can come in late */
+	atomic_write(&tlb_sync->acks, 0);
+	tlb_sync->expected = 0;
+
 	return;
 }
 
@@ -245,6 +395,21 @@ static inline int __sbi_tlb_range_check(struct sbi_tlb_info *curr,
 	if (!curr || !next)
 		return ret;
 
+	/* A full flush covers anything, a whole address space too */
+	if (curr->size == SBI_TLB_FLUSH_ALL) {
+		sbi_hartmask_or(&curr->smask, &curr->smask, &next->smask);
+		return SBI_FIFO_SKIP;
+	}
+	if (next->size == SBI_TLB_FLUSH_ALL) {
+		curr->start = next->start;
+		curr->size  = next->size;
+		sbi_hartmask_or(&curr->smask, &curr->smask, &next->smask);
+		return SBI_FIFO_UPDATED;
+	}
+	/* start == 0 && size == 0 flushes everything as well, leave it */
+	if (!curr->size || !next->size)
+		return ret;
+
 	next_end = next->start + next->size;
 	curr_end = curr->start + curr->size;
 	if (next->start <= curr->start && next_end > curr_end) {
@@ -255,26 +420,42 @@ static inline int __sbi_tlb_range_check(struct sbi_tlb_info *curr,
 	} else if (next->start >= curr->start && next_end <= curr_end) {
 		sbi_hartmask_or(&curr->smask, &curr->smask, &next->smask);
 		ret = SBI_FIFO_SKIP;
+	} else if (next->start <= curr_end && curr->start <= next_end) {
+		/* Overlapping or adjacent: flush the union once */
+		if (next->start < curr->start)
+			curr->start = next->start;
+		if (next_end > curr_end)
+			curr_end = next_end;
+		curr->size = curr_end - curr->start;
+		if (curr->size > tlb_range_flush_limit) {
+			curr->start = 0;
+			curr->size  = SBI_TLB_FLUSH_ALL;
+		}
+		sbi_hartmask_or(&curr->smask, &curr->smask, &next->smask);
+		ret = SBI_FIFO_UPDATED;
 	}
 
 	return ret;
 }
 
 /**
- * Call back to decide if an inplace fifo update is required or next entry can
+ * Call back to decide if an inplace ring update is required or next entry can
  * can be skipped. Here are the different cases that are being handled.
  *
  * Case1:
  *	if next flush request range lies within one of the existing entry, skip
  *	the next entry.
  * Case2:
- *	if flush request range in current fifo entry lies within next flush
+ *	if flush request range in current ring entry lies within next flush
  *	request, update the current entry.
+ * Case3:
+ *	if the two ranges overlap or touch, widen the current entry to their
+ *	union, or to a full flush past the range flush limit.
  *
  * Note:
- *	We can not issue a fifo reset anymore if a complete vma flush is requested.
+ *	We can not issue a ring reset anymore if a complete vma flush is requested.
  *	This is because we are queueing FENCE.I requests as well now.
- *	To ease up the pressure in enqueue/fifo sync path, try to dequeue 1 element
+ *	To ease up the pressure in enqueue/ring sync path, try to dequeue 1 element
  *	before continuing the while loop. This method is preferred over wfi/ipi because
  *	of MMIO cost involved in later method.
  */
@@ -307,8 +488,10 @@ static int sbi_tlb_update(struct sbi_scratch *scratch,
 			  u32 remote_hartid, void *data)
 {
 	int ret;
-	struct sbi_fifo *tlb_fifo_r;
+	struct tlb_ring *tlb_ring_r;
 	struct sbi_tlb_info *tinfo = data;
+	struct tlb_sync *tlb_sync =
+			sbi_scratch_offset_ptr(scratch, tlb_sync_off);
 	u32 curr_hartid = current_hartid();
 
 	/*
@@ -330,24 +513,27 @@ static int sbi_tlb_update(struct sbi_scratch *scratch,
 		return -1;
 	}
 
-	tlb_fifo_r = sbi_scratch_offset_ptr(remote_scratch, tlb_fifo_off);
+	tlb_ring_r = tlb_ring_ptr(remote_scratch);
+
+	/* Queued or merged, the remote HART acks it once either way */
+	tlb_sync->expected++;
 
-	ret = sbi_fifo_inplace_update(tlb_fifo_r, data, sbi_tlb_update_cb);
+	ret = tlb_ring_inplace_update(tlb_ring_r, tinfo, sbi_tlb_update_cb);
 	if (ret != SBI_FIFO_UNCHANGED) {
 		return 1;
 	}
 
-	while (sbi_fifo_enqueue(tlb_fifo_r, data) < 0) {
+	while (tlb_ring_enqueue(tlb_ring_r, tinfo) < 0) {
 		/**
-		 * For now, Busy loop until there is space in the fifo.
+		 * For now, Busy loop until there is space in the ring.
 		 * There may be case where target hart is also
-		 * enqueue in source hart's fifo. Both hart may busy
+		 * enqueue in source hart's ring. Both hart may busy
 		 * loop leading to a deadlock.
 		 * TODO: Introduce a wait/wakeup event mechanism to handle
 		 * this properly.
 		 */
 		sbi_tlb_process_count(scratch, 1);
-		sbi_dprintf("hart%d: hart%d tlb fifo full\n",
+		sbi_dprintf("hart%d: hart%d tlb ring full\n",
 			    curr_hartid, remote_hartid);
 	}
 
@@ -371,12 +557,49 @@ int sbi_tlb_request(ulong hmask, ulong hbase, struct sbi_tlb_info *tinfo)
 	return sbi_ipi_send_many(hmask, hbase, tlb_event, tinfo);
 }
 
+/*
+ * Break-even size between page-wise and full flushes, from the cost of a
+ * full `sfence.vma' over that of one page. Refilling the TLB after a full
+ * flush is not seen here, so this errs on the side of page-wise flushes,
+ * and it is never below one page. Returns 0 without a cycle counter.
+ */
+static unsigned long sbi_tlb_measure_flush_limit(void)
+{
+	unsigned long t0 = 0, page, full, i, limit;
+
+	/* Once to warm up the caches, then timed */
+	for (i = 0; i < 2 * TLB_PROBE_PAGES; i++) {
+		if (i == TLB_PROBE_PAGES)
+			t0 = csr_read(CSR_MCYCLE);
+		__asm__ __volatile__("sfence.vma %0"
+				     :
+				     : "r"((i % TLB_PROBE_PAGES) << PAGE_SHIFT)
+				     : "memory");
+	}
+	page = (csr_read(CSR_MCYCLE) - t0) / TLB_PROBE_PAGES;
+
+	sbi_tlb_flush_all();
+	t0 = csr_read(CSR_MCYCLE);
+	sbi_tlb_flush_all();
+	full = csr_read(CSR_MCYCLE) - t0;
+
+	if (!page)
+		return 0;
+
+	limit = (full / page) * PAGE_SIZE;
+	if (limit < PAGE_SIZE)
+		limit = PAGE_SIZE;
+	if (limit > TLB_PROBE_LIMIT_MAX)
+		limit = TLB_PROBE_LIMIT_MAX;
+	return limit;
+}
+
 int sbi_tlb_init(struct sbi_scratch *scratch, bool cold_boot)
 {
 	int ret;
-	void *tlb_mem;
-	unsigned long *tlb_sync;
-	struct sbi_fifo *tlb_q;
+	unsigned long i, limit;
+	struct tlb_sync *tlb_sync;
+	struct tlb_ring *tlb_ring;
 	const struct sbi_platform *plat = sbi_platform_ptr(scratch);
 
 	if (cold_boot) {
@@ -384,46 +607,46 @@ int sbi_tlb_init(struct sbi_scratch *scratch, bool cold_boot)
 							"IPI_TLB_SYNC");
 		if (!tlb_sync_off)
 			return SBI_ENOMEM;
-		tlb_fifo_off = sbi_scratch_alloc_offset(sizeof(*tlb_q),
-							"IPI_TLB_FIFO");
-		if (!tlb_fifo_off) {
-			sbi_scratch_free_offset(tlb_sync_off);
-			return SBI_ENOMEM;
-		}
-		tlb_fifo_mem_off = sbi_scratch_alloc_offset(
-				SBI_TLB_FIFO_NUM_ENTRIES * SBI_TLB_INFO_SIZE,
-				"IPI_TLB_FIFO_MEM");
-		if (!tlb_fifo_mem_off) {
-			sbi_scratch_free_offset(tlb_fifo_off);
+		tlb_ring_off = sbi_scratch_alloc_offset(
+				sizeof(*tlb_ring) + TLB_CACHELINE - 1,
+				"IPI_TLB_RING");
+		if (!tlb_ring_off) {
 			sbi_scratch_free_offset(tlb_sync_off);
 			return SBI_ENOMEM;
 		}
 		ret = sbi_ipi_event_create(&tlb_ops);
 		if (ret < 0) {
-			sbi_scratch_free_offset(tlb_fifo_mem_off);
-			sbi_scratch_free_offset(tlb_fifo_off);
+			sbi_scratch_free_offset(tlb_ring_off);
 			sbi_scratch_free_offset(tlb_sync_off);
 			return ret;
 		}
 		tlb_event = ret;
 		tlb_range_flush_limit = sbi_platform_tlbr_flush_limit(plat);
+		/* Platforms asking for a limit of their own (errata) keep it */
+		if (tlb_range_flush_limit ==
+		    SBI_PLATFORM_TLB_RANGE_FLUSH_LIMIT_DEFAULT) {
+			limit = sbi_tlb_measure_flush_limit();
+			if (limit)
+				tlb_range_flush_limit = limit;
+		}
 	} else {
 		if (!tlb_sync_off ||
-		    !tlb_fifo_off ||
-		    !tlb_fifo_mem_off)
+		    !tlb_ring_off)
 			return SBI_ENOMEM;
 		if (SBI_IPI_EVENT_MAX <= tlb_event)
 			return SBI_ENOSPC;
 	}
 
 	tlb_sync = sbi_scratch_offset_ptr(scratch, tlb_sync_off);
-	tlb_q = sbi_scratch_offset_ptr(scratch, tlb_fifo_off);
-	tlb_mem = sbi_scratch_offset_ptr(scratch, tlb_fifo_mem_off);
+	tlb_ring = tlb_ring_ptr(scratch);
 
-	*tlb_sync = 0;
+	atomic_write(&tlb_sync->acks, 0);
+	tlb_sync->expected = 0;
 
-	sbi_fifo_init(tlb_q, tlb_mem,
-		      SBI_TLB_FIFO_NUM_ENTRIES, SBI_TLB_INFO_SIZE);
+	tlb_ring->head = 0;
+	tlb_ring->tail = 0;
+	for (i = 0; i < SBI_TLB_RING_NUM_ENTRIES; i++)
+		tlb_ring->slot[i].seq = i;
 
 	return 0;
 }
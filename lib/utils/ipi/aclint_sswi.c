@@ -0,0 +1,54 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * RISC-V ACLINT supervisor-level software interrupt device (SSWI)
+ */
+
+#include <sbi/riscv_io.h>
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_hartmask.h>
+#include <sbi_utils/ipi/aclint_sswi.h>
+
+static struct aclint_sswi_data *sswi_hartid2data[SBI_HARTMASK_MAX_BITS];
+
+/*
+ * Raise the S-mode software interrupt of `target_hart' directly: the
+ * write sets its SSIP, no M-mode trap is taken on that HART. The SETSSIP
+ * register always reads zero, S-mode clears SSIP itself.
+ */
+int aclint_sswi_send(u32 target_hart)
+{
+	u32 *setssip;
+	struct aclint_sswi_data *sswi;
+
+	if (SBI_HARTMASK_MAX_BITS <= target_hart)
+		return SBI_EINVAL;
+	sswi = sswi_hartid2data[target_hart];
+	if (!sswi)
+		return SBI_ENODEV;
+
+	setssip = (void *)sswi->addr;
+	writel(1, &setssip[target_hart - sswi->first_hartid]);
+
+	return 0;
+}
+
+int aclint_sswi_cold_init(struct aclint_sswi_data *sswi)
+{
+	u32 i;
+
+	if (!sswi || (sswi->addr & (ACLINT_SSWI_ALIGN - 1)) ||
+	    (sswi->size < (sswi->hart_count * sizeof(u32))) ||
+	    (sswi->first_hartid >= SBI_HARTMASK_MAX_BITS) ||
+	    (sswi->hart_count > ACLINT_SSWI_MAX_HARTS))
+		return SBI_EINVAL;
+
+	/* Update SSWI hartid table */
+	for (i = 0; i < sswi->hart_count; i++) {
+		if (SBI_HARTMASK_MAX_BITS <= sswi->first_hartid + i)
+			break;
+		sswi_hartid2data[sswi->first_hartid + i] = sswi;
+	}
+
+	return 0;
+}
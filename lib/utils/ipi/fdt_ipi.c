@@ -11,9 +11,11 @@
 #include <sbi_utils/fdt/fdt_helper.h>
 #include <sbi_utils/ipi/fdt_ipi.h>
 
+extern struct fdt_ipi fdt_ipi_mswi;
 extern struct fdt_ipi fdt_ipi_clint;
 
 static struct fdt_ipi *ipi_drivers[] = {
+	&fdt_ipi_mswi,
 	&fdt_ipi_clint
 };
 
@@ -84,7 +86,8 @@ static int fdt_ipi_cold_init(void)
 			break;
 	}
 
-	return 0;
+	/* S-mode IPIs without M-mode, when the platform has an SSWI */
+	return fdt_ipi_sswi_cold_init(fdt);
 }
 
 int fdt_ipi_init(bool cold_boot)
@@ -0,0 +1,63 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * FDT glue of the RISC-V ACLINT SSWI
+ */
+
+#include <libfdt.h>
+#include <sbi/riscv_encoding.h>
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_ipi.h>
+#include <sbi_utils/fdt/fdt_helper.h>
+#include <sbi_utils/ipi/fdt_ipi.h>
+#include <sbi_utils/ipi/aclint_sswi.h>
+
+#define SSWI_MAX_NR			16
+
+static unsigned long sswi_count = 0;
+static struct aclint_sswi_data sswi[SSWI_MAX_NR];
+
+static const struct sbi_ipi_smode_device sswi_smode_dev = {
+	.name = "aclint-sswi",
+	.ipi_send = aclint_sswi_send,
+};
+
+static const struct fdt_match ipi_sswi_match[] = {
+	{ .compatible = "riscv,aclint-sswi" },
+	{ },
+};
+
+/*
+ * The SSWI belongs to S-mode, it is not an M-mode IPI device: its node
+ * stays in the FDT handed to the OS, which then raises IPIs itself. The
+ * firmware only uses it to deliver S-mode IPIs without trapping the
+ * target HART into M-mode.
+ */
+int fdt_ipi_sswi_cold_init(void *fdt)
+{
+	int rc, noff = -1;
+	struct aclint_sswi_data *ss;
+	const struct fdt_match *match;
+
+	while ((noff = fdt_find_match(fdt, noff,
+				      ipi_sswi_match, &match)) >= 0) {
+		if (SSWI_MAX_NR <= sswi_count)
+			return SBI_ENOSPC;
+		ss = &sswi[sswi_count];
+
+		rc = fdt_parse_aclint_node(fdt, noff, IRQ_S_SOFT,
+					   &ss->addr, &ss->size, NULL, NULL,
+					   &ss->first_hartid, &ss->hart_count);
+		if (rc)
+			continue;
+		rc = aclint_sswi_cold_init(ss);
+		if (rc)
+			return rc;
+		sswi_count++;
+	}
+
+	if (sswi_count)
+		sbi_ipi_set_smode_device(&sswi_smode_dev);
+
+	return 0;
+}
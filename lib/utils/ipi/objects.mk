@@ -7,5 +7,9 @@
 #   Anup Patel <anup.patel@wdc.com>
 #
 
+libsbiutils-objs-y += ipi/aclint_mswi.o
+libsbiutils-objs-y += ipi/aclint_sswi.o
 libsbiutils-objs-y += ipi/fdt_ipi.o
+libsbiutils-objs-y += ipi/fdt_ipi_mswi.o
+libsbiutils-objs-y += ipi/fdt_ipi_sswi.o
 libsbiutils-objs-y += ipi/fdt_ipi_clint.o
@@ -0,0 +1,151 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * RISC-V ACLINT machine-level timer device (MTIMER)
+ */
+
+#include <sbi/riscv_asm.h>
+#include <sbi/riscv_atomic.h>
+#include <sbi/riscv_io.h>
+#include <sbi/sbi_error.h>
+#include <sbi/sbi_hartmask.h>
+#include <sbi_utils/timer/aclint_mtimer.h>
+
+static struct aclint_mtimer_data *mtimer_hartid2data[SBI_HARTMASK_MAX_BITS];
+
+#if __riscv_xlen != 32
+static u64 mtimer_time_rd64(volatile u64 *addr)
+{
+	return readq_relaxed(addr);
+}
+
+static void mtimer_time_wr64(u64 value, volatile u64 *addr)
+{
+	writeq_relaxed(value, addr);
+}
+#endif
+
+static u64 mtimer_time_rd32(volatile u64 *addr)
+{
+	u32 lo, hi;
+
+	do {
+		hi = readl_relaxed((u32 *)addr + 1);
+		lo = readl_relaxed((u32 *)addr);
+	} while (hi != readl_relaxed((u32 *)addr + 1));
+
+	return ((u64)hi << 32) | (u64)lo;
+}
+
+static void mtimer_time_wr32(u64 value, volatile u64 *addr)
+{
+	u32 mask = -1U;
+
+	writel_relaxed(value & mask, (void *)(addr));
+	writel_relaxed(value >> 32, (void *)(addr) + 0x04);
+}
+
+u64 aclint_mtimer_value(void)
+{
+	struct aclint_mtimer_data *mt = mtimer_hartid2data[current_hartid()];
+	u64 *time_val = (void *)mt->mtime_addr;
+
+	/* Read MTIMER Time Value */
+	return mt->time_rd(time_val) + mt->time_delta;
+}
+
+void aclint_mtimer_event_stop(void)
+{
+	u32 target_hart = current_hartid();
+	struct aclint_mtimer_data *mt = mtimer_hartid2data[target_hart];
+	u64 *time_cmp = (void *)mt->mtimecmp_addr;
+
+	/* Clear MTIMER Time Compare */
+	mt->time_wr(-1ULL, &time_cmp[target_hart - mt->first_hartid]);
+}
+
+void aclint_mtimer_event_start(u64 next_event)
+{
+	u32 target_hart = current_hartid();
+	struct aclint_mtimer_data *mt = mtimer_hartid2data[target_hart];
+	u64 *time_cmp = (void *)mt->mtimecmp_addr;
+
+	/* Program MTIMER Time Compare */
+	mt->time_wr(next_event - mt->time_delta,
+		    &time_cmp[target_hart - mt->first_hartid]);
+}
+
+int aclint_mtimer_warm_init(void)
+{
+	u64 v1, v2, mv;
+	u32 target_hart = current_hartid();
+	struct aclint_mtimer_data *reference;
+	u64 *mt_time_val, *mt_time_cmp, *ref_time_val;
+	struct aclint_mtimer_data *mt = mtimer_hartid2data[target_hart];
+
+	if (!mt)
+		return SBI_ENODEV;
+
+	/*
+	 * Compute delta if reference available, on a HART which is going
+	 * to use this MTIMER and only once (see clint_warm_timer_init()).
+	 */
+	if (mt->time_delta_reference) {
+		reference = mt->time_delta_reference;
+		mt_time_val = (void *)mt->mtime_addr;
+		ref_time_val = (void *)reference->mtime_addr;
+		if (!atomic_raw_xchg_ulong(&mt->time_delta_computed, 1)) {
+			v1 = mt->time_rd(mt_time_val);
+			mv = reference->time_rd(ref_time_val);
+			v2 = mt->time_rd(mt_time_val);
+			mt->time_delta = mv - ((v1 / 2) + (v2 / 2));
+		}
+	}
+
+	/* Clear Time Compare */
+	mt_time_cmp = (void *)mt->mtimecmp_addr;
+	mt->time_wr(-1ULL, &mt_time_cmp[target_hart - mt->first_hartid]);
+
+	return 0;
+}
+
+int aclint_mtimer_cold_init(struct aclint_mtimer_data *mt,
+			    struct aclint_mtimer_data *reference)
+{
+	u32 i;
+
+	/* Sanity checks */
+	if (!mt || (mt->mtime_addr & (ACLINT_MTIMER_ALIGN - 1)) ||
+	    (mt->mtime_size < 8) ||
+	    (mt->mtimecmp_addr & (ACLINT_MTIMER_ALIGN - 1)) ||
+	    (mt->mtimecmp_size < (mt->hart_count * sizeof(u64))) ||
+	    (mt->first_hartid >= SBI_HARTMASK_MAX_BITS) ||
+	    (mt->hart_count > ACLINT_MTIMER_MAX_HARTS))
+		return SBI_EINVAL;
+	if (reference && mt->mtime_addr == reference->mtime_addr)
+		reference = NULL;
+
+	/* Initialize private data */
+	mt->time_delta_reference = reference;
+	mt->time_delta_computed = 0;
+	mt->time_delta = 0;
+	mt->time_rd = mtimer_time_rd32;
+	mt->time_wr = mtimer_time_wr32;
+
+	/* Override read/write accessors for 64bit MMIO */
+#if __riscv_xlen != 32
+	if (mt->has_64bit_mmio) {
+		mt->time_rd = mtimer_time_rd64;
+		mt->time_wr = mtimer_time_wr64;
+	}
+#endif
+
+	/* Update MTIMER hartid table */
+	for (i = 0; i < mt->hart_count; i++) {
+		if (SBI_HARTMASK_MAX_BITS <= mt->first_hartid + i)
+			break;
+		mtimer_hartid2data[mt->first_hartid + i] = mt;
+	}
+
+	return 0;
+}
@@ -8,12 +8,15 @@
  */
 
 #include <sbi/sbi_scratch.h>
+#include <sbi/sbi_timer.h>
 #include <sbi_utils/fdt/fdt_helper.h>
 #include <sbi_utils/timer/fdt_timer.h>
 
+extern struct fdt_timer fdt_timer_mtimer;
 extern struct fdt_timer fdt_timer_clint;
 
 static struct fdt_timer *timer_drivers[] = {
+	&fdt_timer_mtimer,
 	&fdt_timer_clint
 };
 
@@ -73,10 +76,14 @@ static int fdt_timer_warm_init(void)
 static int fdt_timer_cold_init(void)
 {
 	int pos, noff, rc;
+	unsigned long freq;
 	struct fdt_timer *drv;
 	const struct fdt_match *match;
 	void *fdt = sbi_scratch_thishart_arg1_ptr();
 
+	if (!fdt_parse_timebase_frequency(fdt, &freq))
+		sbi_timer_set_timebase_freq(freq);
+
 	for (pos = 0; pos < array_size(timer_drivers); pos++) {
 		drv = timer_drivers[pos];
 
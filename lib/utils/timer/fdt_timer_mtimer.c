@@ -0,0 +1,69 @@
+/*
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * FDT glue of the RISC-V ACLINT MTIMER
+ */
+
+#include <sbi/riscv_encoding.h>
+#include <sbi/sbi_error.h>
+#include <sbi_utils/fdt/fdt_helper.h>
+#include <sbi_utils/timer/fdt_timer.h>
+#include <sbi_utils/timer/aclint_mtimer.h>
+
+#define MTIMER_MAX_NR			16
+
+static unsigned long mtimer_count = 0;
+static struct aclint_mtimer_data mtimer[MTIMER_MAX_NR];
+
+static int timer_mtimer_cold_init(void *fdt, int nodeoff,
+				  const struct fdt_match *match)
+{
+	int rc;
+	unsigned long addr[2], size[2];
+	struct aclint_mtimer_data *mt, *mtmaster = NULL;
+
+	if (MTIMER_MAX_NR <= mtimer_count)
+		return SBI_ENOSPC;
+	mt = &mtimer[mtimer_count++];
+	if (1 < mtimer_count)
+		mtmaster = &mtimer[0];
+
+	rc = fdt_parse_aclint_node(fdt, nodeoff, IRQ_M_TIMER,
+				   &addr[0], &size[0], &addr[1], &size[1],
+				   &mt->first_hartid, &mt->hart_count);
+	if (rc)
+		return rc;
+
+	if (size[1]) {
+		/* Two regions: mtime, then the mtimecmp array */
+		mt->mtime_addr = addr[0];
+		mt->mtime_size = size[0];
+		mt->mtimecmp_addr = addr[1];
+		mt->mtimecmp_size = size[1];
+	} else {
+		/* One region with the default layout */
+		mt->mtimecmp_addr = addr[0] + ACLINT_DEFAULT_MTIMECMP_OFFSET;
+		mt->mtimecmp_size = ACLINT_DEFAULT_MTIME_OFFSET;
+		mt->mtime_addr = addr[0] + ACLINT_DEFAULT_MTIME_OFFSET;
+		mt->mtime_size = ACLINT_DEFAULT_MTIME_SIZE;
+	}
+	/* TODO: We should figure-out MTIMER has_64bit_mmio from DT node */
+	mt->has_64bit_mmio = TRUE;
+
+	return aclint_mtimer_cold_init(mt, mtmaster);
+}
+
+static const struct fdt_match timer_mtimer_match[] = {
+	{ .compatible = "riscv,aclint-mtimer" },
+	{ },
+};
+
+struct fdt_timer fdt_timer_mtimer = {
+	.match_table = timer_mtimer_match,
+	.cold_init = timer_mtimer_cold_init,
+	.warm_init = aclint_mtimer_warm_init,
+	.exit = NULL,
+	.value = aclint_mtimer_value,
+	.event_stop = aclint_mtimer_event_stop,
+	.event_start = aclint_mtimer_event_start,
+};